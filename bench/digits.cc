@@ -0,0 +1,80 @@
+// Parses a /proc/stat of a 128 thread machine over and over with each digits
+// kernel the CPU supports and prints the time per file and per line, which is
+// what digits::best() is chosen by.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "digits.hh"
+
+namespace {
+
+constexpr int rounds = 10;
+constexpr int repetitions = 20000;
+
+std::string proc_stat() {
+  std::string text = "cpu  123456789 2345 34567890 987654321 12345 0 23456 0 0 0\n";
+  for (int i = 0; i < 128; ++i) {
+    char line[200];
+    std::snprintf(line, sizeof line, "cpu%d %d %d %d %d %d 0 %d 0 0 0\n", i, 1234567 + i * 37, 23 + i, 345678 + i,
+                  98765432 + i * 11, 1234 + i, 234 + i);
+    text += line;
+  }
+  return text;
+}
+
+} // namespace
+
+int main() {
+  auto text = proc_stat();
+  char const *begin = text.data();
+  char const *end = begin + text.size();
+
+  // Where the numbers of each line start, after the cpuN label.
+  std::vector<char const *> lines;
+  for (char const *p = begin; p < end;) {
+    while (*p != ' ')
+      ++p;
+    lines.push_back(p);
+    while (p < end && *p++ != '\n')
+      ;
+  }
+
+  constexpr digits::kernel kernels[] = {digits::kernel::scalar, digits::kernel::sse2, digits::kernel::avx2};
+  // The fastest of a few rounds, the kernels take turns so that frequency
+  // changes and noisy neighbours affect all of them alike.
+  double fastest[std::size(kernels)];
+  std::ranges::fill(fastest, std::numeric_limits<double>::infinity());
+  std::uint64_t sum = 0;
+  for (int round = 0; round < rounds; ++round) {
+    for (size_t i = 0; i < std::size(kernels); ++i) {
+      if (!digits::supported(kernels[i]))
+        continue;
+
+      std::uint64_t numbers[10];
+      auto start = std::chrono::steady_clock::now();
+      for (int r = 0; r < repetitions; ++r) {
+        for (auto line : lines) {
+          char const *it = line;
+          digits::parse(kernels[i], it, end, numbers);
+          sum += numbers[0] + numbers[3];
+        }
+        // Keeps the parsing from being optimized away.
+        asm volatile("" ::"r"(sum));
+      }
+      std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+      fastest[i] = std::min(fastest[i], elapsed.count() / repetitions);
+    }
+  }
+
+  for (size_t i = 0; i < std::size(kernels); ++i)
+    if (digits::supported(kernels[i]))
+      std::printf("%-6s %8.3f us/file %7.2f ns/line%s\n", digits::name(kernels[i]).data(), fastest[i] / 1000,
+                  fastest[i] / lines.size(), kernels[i] == digits::best() ? " (best)" : "");
+}
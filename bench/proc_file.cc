@@ -0,0 +1,166 @@
+// Reads /proc/stat and /proc/meminfo over and over, once through proc_file and
+// proc_scanner the way the samplers do and once with the ifstream parsing the
+// CPU and memory blocks used before, and prints the time and the allocations
+// per read.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "proc_file.hh"
+#include "samplers.hh"
+
+namespace {
+
+std::atomic<std::size_t> allocations{0};
+
+constexpr int reads = 20000;
+
+struct result {
+  double ns;
+  double allocations;
+};
+
+template <typename F> result measure(F &&read) {
+  for (int i = 0; i < reads / 10; ++i)
+    read();
+  auto before = allocations.load(std::memory_order_relaxed);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < reads; ++i)
+    read();
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return {elapsed.count() / reads, (double)(allocations.load(std::memory_order_relaxed) - before) / reads};
+}
+
+void report(char const *file, result before, result after) {
+  std::printf("%-14s ifstream %7.2f us %5.1f allocs   proc_file %7.2f us %5.1f allocs\n", file, before.ns / 1000,
+              before.allocations, after.ns / 1000, after.allocations);
+}
+
+// What CpuBlock::read_cpu_times did.
+struct old_cpu_times {
+  using times = samplers::cpu_times::times;
+  times total;
+  std::vector<times> percore;
+};
+
+old_cpu_times old_read_stat() {
+  std::ifstream stat("/proc/stat");
+
+  old_cpu_times all;
+  std::string name;
+  auto read_times = [&stat](old_cpu_times::times &t) {
+    stat >> t.user >> t.nice >> t.system >> t.idle >> t.iowait >> t.irq >> t.softirq >> t.steal >> t.guest >>
+        t.guest_nice;
+  };
+  stat >> name;
+  read_times(all.total);
+  while (stat >> name && name.starts_with("cpu")) {
+    old_cpu_times::times t;
+    read_times(t);
+    all.percore.push_back(std::move(t));
+  }
+  return all;
+}
+
+// What MemoryBlock::update did.
+samplers::memory_info old_read_meminfo() {
+  samplers::memory_info info;
+  auto file = std::ifstream("/proc/meminfo");
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.find("MemTotal:") != std::string::npos)
+      info.total = std::stoul(line.substr(line.find_last_of(':') + 1));
+    else if (line.find("MemAvailable:") != std::string::npos)
+      info.available = std::stoul(line.substr(line.find_last_of(':') + 1));
+  }
+  return info;
+}
+
+// The same parsing as the samplers' stat_source and meminfo_source.
+void read_stat(proc_file &file, samplers::cpu_times &all) {
+  proc_scanner scan(file.read());
+
+  std::uint64_t fields[10] = {};
+  scan.skip_word();
+  scan.numbers(fields);
+  all.total = {(long)fields[0], (long)fields[1], (long)fields[2], (long)fields[3], (long)fields[4],
+               (long)fields[5], (long)fields[6], (long)fields[7], (long)fields[8], (long)fields[9]};
+  scan.next_line();
+
+  all.ids.clear();
+  all.busy.clear();
+  all.notbusy.clear();
+  while (scan.consume("cpu")) {
+    std::ranges::fill(fields, 0);
+    all.ids.push_back(scan.number());
+    scan.numbers(fields);
+    scan.next_line();
+    all.busy.push_back(fields[0] + fields[1] + fields[2] + fields[5] + fields[6] + fields[7] + fields[8] + fields[9]);
+    all.notbusy.push_back(fields[3] + fields[4]);
+  }
+}
+
+void read_meminfo(proc_file &file, samplers::memory_info &info) {
+  proc_scanner scan(file.read());
+
+  info = {};
+  bool found_total = false, found_available = false;
+  while (!scan.done() && !(found_total && found_available)) {
+    if (scan.consume("MemTotal:")) {
+      info.total = scan.number();
+      found_total = true;
+    } else if (scan.consume("MemAvailable:")) {
+      info.available = scan.number();
+      found_available = true;
+    }
+    scan.next_line();
+  }
+}
+
+} // namespace
+
+void *operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+int main() {
+  // Keeps the reads from being optimized away.
+  long sink = 0;
+
+  {
+    proc_file file("/proc/stat");
+    samplers::cpu_times all;
+    auto before = measure([&] { sink += old_read_stat().total.user; });
+    auto after = measure([&] {
+      read_stat(file, all);
+      sink += all.total.user;
+    });
+    report("/proc/stat", before, after);
+  }
+
+  {
+    proc_file file("/proc/meminfo");
+    samplers::memory_info info;
+    auto before = measure([&] { sink += old_read_meminfo().available; });
+    auto after = measure([&] {
+      read_meminfo(file, info);
+      sink += info.available;
+    });
+    report("/proc/meminfo", before, after);
+  }
+
+  return sink == 0;
+}
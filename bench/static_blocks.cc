@@ -0,0 +1,120 @@
+// Draws a bar of small blocks over and over, once as a static_blocks group and
+// once the way bar::redraw draws dynamically added blocks (each into its own
+// BufDraw, then replayed at its position), and prints the time per frame.
+//
+// The draw target only counts what it is asked to draw, so this measures the
+// dispatch and recording overhead and not the GL side.
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "static_blocks.hh"
+
+namespace {
+
+class counting_draw final : public ui::draw {
+public:
+  std::size_t operations = 0;
+  pos_t extent = 0;
+
+  pos_t height() const override { return 24; }
+  pos_t width() const override { return 1920; }
+  pos_t vcenter() const override { return 12; }
+  pos_t hcenter() const override { return 960; }
+
+  void line(pos_t, pos_t, pos_t x2, pos_t, color) override { _op(x2); }
+  void hrect(pos_t x, pos_t, pos_t w, pos_t, color) override { _op(x + w); }
+  void frect(pos_t x, pos_t, pos_t w, pos_t, color) override { _op(x + w); }
+  void fcircle(pos_t x, pos_t, pos_t d, color) override { _op(x + d); }
+  pos_t text(pos_t x, pos_t, std::string_view text, color) override {
+    _op(x);
+    return textsz(text).x;
+  }
+  uvec2 textsz(std::string_view text) override { return {pos_t(7 * text.size()), 14}; }
+
+private:
+  void _op(pos_t x) {
+    ++operations;
+    extent = std::max(extent, x);
+  }
+};
+
+// About what a usage block draws: a label, a few bars and a percentage.
+template <int I> class sample_block final : public Block {
+public:
+  size_t draw(ui::draw &draw, std::chrono::duration<double>, size_t, bool) override {
+    ui::draw::pos_t x = draw.text(0, "CPU ");
+    for (int i = 0; i < 8; ++i) {
+      draw.hrect(x, 3, 6, draw.height() - 6);
+      draw.frect(x + 1, 4 + (i + I) % 10, 4, draw.height() - 8 - (i + I) % 10, 0x00FF00);
+      x += 8;
+    }
+    return x + draw.text(x + 4, "42.0%") + 4;
+  }
+};
+
+template <int... Is> using group = static_blocks<sample_block<Is>...>;
+
+constexpr int frames = 200000;
+
+template <typename F> double time_per_frame(F &&frame) {
+  for (int i = 0; i < frames / 10; ++i)
+    frame();
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < frames; ++i)
+    frame();
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / frames;
+}
+
+} // namespace
+
+int main() {
+  using layout = bar_layout<Block *>;
+  constexpr std::chrono::duration<double> delta{1.0 / 60};
+
+  counting_draw target;
+
+  group<0, 1, 2, 3, 4, 5, 6, 7> grouped(std::tuple{}, std::tuple{}, std::tuple{}, std::tuple{}, std::tuple{},
+                                        std::tuple{}, std::tuple{}, std::tuple{});
+  double static_ns = time_per_frame([&] { grouped.draw(target, delta, 0, false); });
+
+  std::vector<std::unique_ptr<Block>> blocks;
+  blocks.push_back(std::make_unique<sample_block<0>>());
+  blocks.push_back(std::make_unique<sample_block<1>>());
+  blocks.push_back(std::make_unique<sample_block<2>>());
+  blocks.push_back(std::make_unique<sample_block<3>>());
+  blocks.push_back(std::make_unique<sample_block<4>>());
+  blocks.push_back(std::make_unique<sample_block<5>>());
+  blocks.push_back(std::make_unique<sample_block<6>>());
+  blocks.push_back(std::make_unique<sample_block<7>>());
+  std::vector<std::unique_ptr<BufDraw>> recordings;
+  for (size_t i = 0; i < blocks.size(); ++i)
+    recordings.push_back(std::make_unique<BufDraw>(target));
+
+  double dynamic_ns = time_per_frame([&] {
+    layout::pos_t x = 0;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+      if (blocks[i]->skip())
+        continue;
+      if (x != 0) {
+        x += layout::separator_margin;
+        target.frect(x, 3, layout::separator_width, target.height() - 6, 0xD3D3D3);
+        x += layout::separator_width + layout::separator_margin;
+      }
+      recordings[i]->clear();
+      auto width = blocks[i]->draw(*recordings[i], delta, x, false);
+      recordings[i]->draw_offset(x, 0);
+      x += width;
+    }
+  });
+
+  std::printf("%zu blocks, %d frames each\n", blocks.size(), frames);
+  std::printf("static_blocks: %8.1f ns/frame\n", static_ns);
+  std::printf("dynamic:       %8.1f ns/frame\n", dynamic_ns);
+  // Keeps the draws from being optimized away.
+  return target.operations == 0;
+}
@@ -1,7 +1,20 @@
+#include <wayland-client.h>
+
 #include "bar.hh"
 #include "config.hh"
 
 void bar::_ui_init() {
+  // Scanning the fontconfig configuration and loading fonts takes a while but
+  // needs neither the display nor GL, so it runs while those are set up and
+  // the blocks are initialized.
+  _fonts_loading = std::async(std::launch::async, [] {
+    auto fonts = std::make_shared<ui::fonts>();
+    for (auto fname : config::fonts)
+      fonts->add(fname);
+    perf::startup_step("fonts loaded");
+    return fonts;
+  });
+
   for (auto platform : config::init_platform_order) {
     glfwGetError(NULL);
     glfwInitHint(GLFW_PLATFORM, platform);
@@ -15,6 +28,7 @@ void bar::_ui_init() {
     fmt::println(error, "Failed to initialize GLFW with any platform from config::platform_priority");
     throw;
   }
+  perf::startup_step("display connected");
 
   glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
   glfwWindowHint(GLFW_DECORATED, GLFW_FALSE);
@@ -60,25 +74,29 @@ void bar::_ui_init() {
   GLFWwindow *window =
       BAR_GLFW_CALL(CreateWindow, _monitor_size.x, _height, config::x11::window_name.data(), NULL, NULL);
 
-  glfwWindowHintString(GLFW_X11_CLASS_NAME, "");
-  glfwWindowHintString(GLFW_X11_INSTANCE_NAME, "");
-  glfwWindowHint(GLFW_WAYLAND_ZWLR_LAYER, GLFW_FALSE);
-
-  GLFWwindow *tooltip_window = BAR_GLFW_CALL(CreateWindow, 1, 1, "bar tooltip", NULL, NULL);
-
-  if (platform == GLFW_PLATFORM_X11)
+  if (platform == GLFW_PLATFORM_X11 && config::x11::override_redirect)
     if (Window xwindow = glfwGetX11Window(window); xwindow != None) {
       XSetWindowAttributes attr;
       attr.override_redirect = true;
-      XChangeWindowAttributes(glfwGetX11Display(), glfwGetX11Window(tooltip_window), CWOverrideRedirect, &attr);
-      if (config::x11::override_redirect) {
-        XChangeWindowAttributes(glfwGetX11Display(), xwindow, CWOverrideRedirect, &attr);
-      }
+      XChangeWindowAttributes(glfwGetX11Display(), xwindow, CWOverrideRedirect, &attr);
     }
 
   glfwMakeContextCurrent(window);
   int version = gladLoadGL(glfwGetProcAddress);
   fmt::print(info, "OpenGL version: {}.{}\n", GLAD_VERSION_MAJOR(version), GLAD_VERSION_MINOR(version));
+  perf::startup_step("GL loaded");
+
+  _frame_pacer.attach(window);
+
+  // With frame callbacks we already know that the compositor wants a new frame
+  // when we draw one, letting EGL wait for its own callback would only block
+  // forever while the surface is hidden.
+  _swap_interval = _frame_pacer.active() ? 0 : config::swap_interval;
+  glfwSwapInterval(_swap_interval);
+
+  _frame_scheduler.configure(config::max_fps, config::animation_interval);
+  _update_scheduler.configure(config::update_tick);
+  _single_threaded = config::single_threaded;
 
   // if (auto conn_opt = ui::x11::connection::try_create(); conn_opt) {
   // _connection = std::unique_ptr(std::move(*conn_opt));
@@ -88,119 +106,567 @@ void bar::_ui_init() {
   // XSelectInput(x11conn->display(), x11mainwin->window_id(), LeaveWindowMask | EnterWindowMask);
   // XSelectInput(x11conn->display(), x11tooltipwin->window_id(), LeaveWindowMask | EnterWindowMask);
 
+  // The callbacks run on the UI thread, they only record what happened for the
+  // render thread, see _apply_pointer.
   glfwSetCursorEnterCallback(window, [](GLFWwindow *, int entered) {
-    if (entered == GLFW_FALSE)
-      bar::instance()._hovered_block_threatened |= 1;
-    else
-      bar::instance()._hovered_block_threatened |= 2;
+    perf::timing::scope measure(perf::global().events);
+    bar::instance()._pointer_crossed(entered == GLFW_TRUE, true);
   });
 
-  glfwSetCursorEnterCallback(tooltip_window, [](GLFWwindow *, int entered) {
-    if (entered == GLFW_FALSE)
-      bar::instance()._hovered_block_threatened |= 1;
-    else
-      bar::instance()._hovered_block_threatened |= 2;
+  glfwSetWindowIconifyCallback(window, [](GLFWwindow *, int iconified) {
+    bar::instance()._set_hidden(ui::hidden_reason::iconified, iconified == GLFW_TRUE);
   });
 
   glfwSetCursorPosCallback(window, [](GLFWwindow *, double x, double y) {
+    perf::timing::scope measure(perf::global().events);
     auto &bar = bar::instance();
-    auto block_lists = {std::views::all(bar._right_blocks), std::views::all(bar._left_blocks)};
-    auto all_blocks = std::ranges::join_view(block_lists);
-    bar._last_mouse_move = std::chrono::steady_clock::now();
-
-    x /= bar._window.drawer().x_render_scale();
-    y /= bar._window.drawer().y_render_scale();
-
-    bar._hovered_block = nullptr;
-    for (auto &info : all_blocks) {
-      if (info.last_pos.x <= x && info.last_pos.y <= y && info.last_pos.x + info.last_size.x > x &&
-          info.last_pos.y + info.last_size.y > y) {
-        bar._hovered_block = &info;
-        break;
-      }
+    auto now = std::chrono::steady_clock::now();
+
+    x /= bar._input_x_scale.load(std::memory_order_relaxed);
+    y /= bar._input_y_scale.load(std::memory_order_relaxed);
+
+    {
+      std::lock_guard lock(bar._pointer_mutex);
+      bar._pointer.pos = {x, y};
+      if (!bar._pointer.moved_at)
+        bar._pointer.moved_at = now;
+      // Whatever left before this motion doesn't count.
+      bar._pointer.threatened = 0;
     }
+    bar._events_for_renderer = true;
+  });
 
-    if (bar._hovered_block)
-      bar._hovered_block_threatened = 0b100;
-    // std::cerr << '(' << x << ", " << y << ") ";
-    // if (bar._hovered_block)
-    //   std::cerr << typeid(bar._hovered_block->block).name() << '\n';
-    // else
-    //   std::cerr << "none\n";
+  glfwSetMouseButtonCallback(window, [](GLFWwindow *, int button, int action, int) {
+    perf::timing::scope measure(perf::global().events);
+    if (action == GLFW_PRESS)
+      bar::instance()._queue_input(button, 0, 0);
+  });
+
+  glfwSetScrollCallback(window, [](GLFWwindow *, double dx, double dy) {
+    perf::timing::scope measure(perf::global().events);
+    bar::instance()._queue_input(-1, dx, dy);
   });
 
   _window = ui::gwindow(window);
-  _tooltip_window = ui::gwindow(tooltip_window);
+  _window.drawer().set_fixed_rendering_height(24);
+  _input_x_scale.store(_window.drawer().x_render_scale(), std::memory_order_relaxed);
+  _input_y_scale.store(_window.drawer().y_render_scale(), std::memory_order_relaxed);
+
+  glfwMakeContextCurrent(nullptr);
+}
 
-  auto fonts = std::make_shared<ui::fonts>();
-  for (auto fname : config::fonts)
-    fonts->add(fname);
+// Called on the render thread before the first frame.
+void bar::_ui_use_fonts() {
+  _window.drawer().texter().set_fonts(_fonts_loading.get());
+}
 
-  _window.drawer().set_fixed_rendering_height(24);
-  _window.drawer().texter().set_fonts(std::shared_ptr(fonts));
-  _tooltip_window.drawer().texter().set_fonts(std::move(fonts));
+// Most of the time nothing with a tooltip is ever hovered over, so the tooltip
+// window and its GL context are only created when the first one is shown. The
+// render thread asks the UI thread to create the window, then makes it its own.
+bool bar::_tooltip_window_ready() {
+  if (_tooltip_window_adopted)
+    return true;
+
+  if (_single_threaded)
+    _create_tooltip_window();
+  else if (!_tooltip_window_requested.exchange(true, std::memory_order_relaxed))
+    glfwPostEmptyEvent();
+
+  GLFWwindow *tooltip_window = _tooltip_glfw_window.load(std::memory_order_acquire);
+  if (!tooltip_window)
+    return false;
+
+  glfwMakeContextCurrent(tooltip_window);
+  glfwSwapInterval(_swap_interval);
+  _tooltip_window.drawer().texter().set_fonts(std::shared_ptr(_window.drawer().texter().get_fonts()));
+  _tooltip_window_adopted = true;
+  return true;
+}
+
+bool bar::_tooltip_window_pending() const {
+  return _tooltip_window_requested.load(std::memory_order_relaxed) &&
+         !_tooltip_glfw_window.load(std::memory_order_acquire);
+}
+
+// Runs on the UI thread.
+void bar::_create_tooltip_window() {
+  glfwWindowHintString(GLFW_X11_CLASS_NAME, "");
+  glfwWindowHintString(GLFW_X11_INSTANCE_NAME, "");
+  glfwWindowHint(GLFW_WAYLAND_ZWLR_LAYER, GLFW_FALSE);
+
+  GLFWwindow *tooltip_window = BAR_GLFW_CALL(CreateWindow, 1, 1, "bar tooltip", NULL, NULL);
+
+  if (glfwGetPlatform() == GLFW_PLATFORM_X11) {
+    XSetWindowAttributes attr;
+    attr.override_redirect = true;
+    XChangeWindowAttributes(glfwGetX11Display(), glfwGetX11Window(tooltip_window), CWOverrideRedirect, &attr);
+  }
+
+  glfwSetCursorEnterCallback(tooltip_window, [](GLFWwindow *, int entered) {
+    perf::timing::scope measure(perf::global().events);
+    bar::instance()._pointer_crossed(entered == GLFW_TRUE, false);
+  });
 
+  // The drawer installs its callbacks and queries the window, which has to
+  // happen here. The render thread only makes the context current afterwards.
+  glfwMakeContextCurrent(tooltip_window);
+  _tooltip_window = ui::gwindow(tooltip_window);
+  _tooltip_window.drawer();
   glfwMakeContextCurrent(nullptr);
+
+  _tooltip_frame_pacer.attach(tooltip_window);
+  _tooltip_glfw_window.store(tooltip_window, std::memory_order_release);
+  _wake_renderer();
+  perf::startup_step("tooltip window created");
+}
+
+// Runs on the render thread, asks the UI thread to move the tooltip window
+// unless it is already where it should be. Returns whether it has to be waited
+// for, the render thread is woken up once it was moved.
+bool bar::_place_tooltip(tooltip_placement const &placement) {
+  if (placement == _tooltip_placement)
+    return false;
+  _tooltip_placement = placement;
+
+  if (_single_threaded) {
+    _apply_tooltip_placement(placement);
+    return false;
+  }
+
+  {
+    std::lock_guard lock(_tooltip_mutex);
+    _tooltip_request = placement;
+    _tooltip_moving.store(true, std::memory_order_relaxed);
+  }
+  glfwPostEmptyEvent();
+  return true;
+}
+
+// Runs on the UI thread.
+void bar::_move_tooltip_window() {
+  std::optional<tooltip_placement> placement;
+  {
+    std::lock_guard lock(_tooltip_mutex);
+    placement = std::exchange(_tooltip_request, std::nullopt);
+  }
+  if (!placement)
+    return;
+
+  _apply_tooltip_placement(*placement);
+  {
+    std::lock_guard lock(_tooltip_mutex);
+    // Another request came in meanwhile, it is carried out on the next wakeup.
+    if (!_tooltip_request)
+      _tooltip_moving.store(false, std::memory_order_release);
+  }
+  _wake_renderer();
+}
+
+void bar::_apply_tooltip_placement(tooltip_placement const &placement) {
+  GLFWwindow *window = _tooltip_glfw_window.load(std::memory_order_acquire);
+  glfwSetWindowPos(window, placement.pos.x, placement.pos.y);
+  glfwSetWindowSize(window, placement.size.x, placement.size.y);
+  if (placement.visible)
+    glfwShowWindow(window);
+  else
+    glfwHideWindow(window);
+}
+
+// Runs on the UI thread.
+void bar::_pointer_crossed(bool entered, bool bar_window) {
+  auto now = std::chrono::steady_clock::now();
+  {
+    std::lock_guard lock(_pointer_mutex);
+    _pointer.threatened |= entered ? 2 : 1;
+    if (!entered && bar_window)
+      _pointer.pos.reset();
+    if (!_pointer.crossed_at)
+      _pointer.crossed_at = now;
+  }
+  _events_for_renderer = true;
+}
+
+// Runs on the render thread, catches up on what the UI thread saw of the pointer.
+void bar::_apply_pointer() {
+  pointer_state pointer;
+  {
+    std::lock_guard lock(_pointer_mutex);
+    pointer = _pointer;
+    _pointer.moved_at.reset();
+    _pointer.crossed_at.reset();
+    _pointer.input_at.reset();
+    _pointer.threatened = 0;
+  }
+
+  _cursor_pos = pointer.pos;
+  if (pointer.input_at)
+    _input_received(*pointer.input_at);
+  if (pointer.crossed_at && _hovered_block)
+    _input_received(*pointer.crossed_at);
+
+  if (!pointer.moved_at || !_cursor_pos) {
+    _hovered_block_threatened |= pointer.threatened;
+    return;
+  }
+
+  auto [x, y] = *_cursor_pos;
+  auto *hovered = _hit_test(x, y);
+  bool changed = hovered != _hovered_block;
+  _hovered_block = hovered;
+  if (hovered) {
+    changed |= hovered->block->hover(x - hovered->slot.x);
+    // We are still over the bar, only what left it after the motion counts.
+    _hovered_block_threatened = pointer.threatened;
+  } else
+    _hovered_block_threatened |= pointer.threatened;
+
+  // Moving around inside of the same block doesn't change anything on screen,
+  // otherwise only the tooltip has to be redrawn and that right away.
+  if (changed) {
+    _tooltip_dirty = true;
+    _input_received(*pointer.moved_at);
+  }
 }
 
 void bar::_setup_block(BlockInfo &info) { info.block->setup(); }
 
-void bar::_ui_process_events(std::stop_token token, std::chrono::steady_clock::time_point until) {
-  while (true) {
+void bar::_apply_power_profile(power::profile const &profile) {
+  fmt::print(debug, "Applying power profile: {}x frame rate, {}x animation rate, {}x update intervals\n",
+             profile.frame_rate, profile.animation_rate, profile.update_interval);
+
+  _frame_scheduler.configure(config::max_fps * profile.frame_rate,
+                             std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                 config::animation_interval / profile.animation_rate));
+  _update_scheduler.scale(profile.update_interval);
+  // Wakes up the render thread so the new frame deadline is used right away.
+  schedule_redraw();
+}
+
+void bar::_queue_input(int button, double dx, double dy) {
+  auto now = std::chrono::steady_clock::now();
+  std::optional<std::pair<double, double>> pos;
+  {
+    std::lock_guard lock(_pointer_mutex);
+    pos = _pointer.pos;
+  }
+  if (!pos || pos->second < 0 || pos->second >= _height)
+    return;
+
+  // The layout belongs to the render thread, we go by the last frame's.
+  auto x = pos->first;
+  auto const &boxes = _hit_boxes.read();
+  auto box = std::ranges::upper_bound(boxes, x, std::less{}, [](hit_box const &box) { return (double)box.begin; });
+  if (box == boxes.begin() || x >= (--box)->end)
+    return;
+
+  {
+    std::lock_guard lock(_pointer_mutex);
+    if (!_pointer.input_at)
+      _pointer.input_at = now;
+  }
+  // If the loop thread is so far behind that the queue is full, dropping input
+  // is still better than making the UI thread wait for it.
+  (void)_input_queue.push({.block = box->block,
+                           .x = (ui::draw::pos_t)(x - box->begin),
+                           .button = button,
+                           .dx = dx,
+                           .dy = dy});
+  uv_async_send(&_input_async);
+}
+
+// Runs on the loop thread.
+void bar::_dispatch_input() {
+  auto deliver = [](input_event const &event) {
+    if (event.button == -1)
+      event.block->scroll(event.x, event.dx, event.dy);
+    else
+      event.block->click(event.x, event.button);
+  };
+
+  // Consecutive scroll events over the same block are summed up, so a burst of
+  // them (that's what a wheel or touchpad produces) doesn't do the work for each.
+  std::optional<input_event> scrolled;
+  while (auto event = _input_queue.pop()) {
+    if (scrolled && event->button == -1 && event->block == scrolled->block) {
+      scrolled->x = event->x;
+      scrolled->dx += event->dx;
+      scrolled->dy += event->dy;
+      continue;
+    }
+
+    if (scrolled)
+      deliver(*std::exchange(scrolled, std::nullopt));
+    if (event->button == -1)
+      scrolled = event;
+    else
+      deliver(*event);
+  }
+  if (scrolled)
+    deliver(*scrolled);
+}
+
+bar::BlockInfo *bar::_hit_test(double x, double y) const {
+  if (x < 0 || y < 0 || y >= _height)
+    return nullptr;
+  return _layout.hit(x).value_or(nullptr);
+}
+
+void bar::_set_hidden(ui::hidden_reason reason, bool hidden) {
+  auto bit = (unsigned)reason;
+  auto previous = hidden ? _hidden.fetch_or(bit, std::memory_order_acq_rel)
+                         : _hidden.fetch_and(~bit, std::memory_order_acq_rel);
+  auto current = hidden ? previous | bit : previous & ~bit;
+  if ((previous == 0) == (current == 0))
+    return;
+
+  fmt::print(debug, "Bar is now {}\n", current ? "hidden" : "visible");
+  if (!current)
+    _catching_up.store(true, std::memory_order_release);
+  uv_async_send(&_visibility_async);
+  if (!_single_threaded)
+    _wake_renderer();
+}
+
+// Runs on the loop thread.
+void bar::_on_visibility_changed() {
+  if (_hidden.load(std::memory_order_acquire)) {
+    _update_scheduler.hide(config::hidden_update_interval);
+  } else {
+    _update_scheduler.show();
+    // In case we were hidden too briefly for the update scheduler to notice,
+    // the render thread is waiting for this.
+    schedule_redraw();
+  }
+}
+
+std::optional<std::chrono::steady_clock::time_point> bar::_bar_wakeup(std::chrono::steady_clock::time_point now) {
+  // Compositors stop answering frame callbacks while the surface can't be
+  // seen, if one takes this long we are most likely hidden.
+  auto starved_at = _frame_pacer.requested_at() + config::hidden_after;
+  if (_frame_pacer.can_present())
+    _set_hidden(ui::hidden_reason::no_frame_callbacks, false);
+  else if (now >= starved_at)
+    _set_hidden(ui::hidden_reason::no_frame_callbacks, true);
+
+  // Nothing is drawn while hidden, once visible again the first frame waits
+  // for the fresh block updates requested by _on_visibility_changed.
+  if (_hidden.load(std::memory_order_acquire) ||
+      (_catching_up.load(std::memory_order_acquire) && !_frame_scheduler.requested()))
+    return std::nullopt;
+  // While a frame callback is pending the compositor doesn't want a new
+  // frame yet, it will wake us up with the callback once it does.
+  if (!_frame_pacer.can_present())
+    return starved_at;
+  return _frame_scheduler.deadline();
+}
+
+bool bar::_tooltip_pending() const {
+  // The UI thread wakes us up once the window we asked for exists or was moved.
+  return (_tooltip_dirty || _hovered_block_threatened) && _tooltip_frame_pacer.can_present() &&
+         !_tooltip_window_pending() && !_tooltip_moving.load(std::memory_order_acquire);
+}
+
+std::optional<std::chrono::steady_clock::time_point> bar::_ui_wakeup(std::chrono::steady_clock::time_point now) {
+  _apply_pointer();
+  auto wakeup = _bar_wakeup(now);
+  if (_tooltip_pending())
+    return now;
+  return wakeup;
+}
+
+// Runs on the render thread, returns once something has to be drawn.
+void bar::_render_wait(std::stop_token token) {
+  while (!token.stop_requested()) {
     auto now = std::chrono::steady_clock::now();
-    if (token.stop_requested())
+    auto wakeup = _ui_wakeup(now);
+    if (wakeup && now >= *wakeup)
       break;
-    if (now >= until) {
-      if (_redraw_requested.load(std::memory_order_acquire))
-        break;
-      else
-        glfwWaitEvents();
-    } else
-      glfwWaitEventsTimeout(std::chrono::duration_cast<std::chrono::milliseconds>(until - now).count() / 1000.0);
+
+    // Whoever changes what _ui_wakeup looks at wakes us up afterwards, so
+    // nothing is missed between the check above and going to sleep.
+    std::unique_lock lock(_render_mutex);
+    auto woken = [this] { return _render_woken; };
+    if (!wakeup)
+      _render_wakeup.wait(lock, token, woken);
+    else
+      _render_wakeup.wait_until(lock, token, *wakeup, woken);
+    _render_woken = false;
+    perf::global().render_wakeups.fetch_add(1, std::memory_order_relaxed);
   }
 }
 
+void bar::_swap_buffers(GLFWwindow *window) {
+  // A non-zero swap interval may make the swap block until the next vblank,
+  // without a UI thread handle whatever input arrived during the frame before
+  // that happens.
+  if (_swap_interval != 0 && _single_threaded)
+    glfwPollEvents();
+  glfwSwapBuffers(window);
+}
+
+void bar::_ui_frame(std::chrono::steady_clock::time_point now) {
+  if (_hovered_block_threatened == 0b01) {
+    _hovered_block = nullptr;
+    _tooltip_dirty = true;
+  }
+  _hovered_block_threatened = 0;
+
+  // Input only needs the tooltip to be redrawn, which is cheap and doesn't
+  // have to wait for the bar's frame budget.
+  if (auto due = _bar_wakeup(now); !due || now < *due) {
+    if (_tooltip_dirty)
+      _draw_tooltip(now);
+    _input_presented();
+    return;
+  }
+
+  _frame_scheduler.begin_frame();
+  _catching_up.store(false, std::memory_order_release);
+
+  {
+    auto delta = now - _last_redraw;
+    for (auto &block : _left_blocks)
+      block.block->animate(delta);
+    for (auto &block : _right_blocks)
+      block.block->animate(delta);
+
+    // fmt::println(debug, "Redrawing! ({:>6.3f}ms elapsed since last redraw)",
+    //              (double)std::chrono::duration_cast<std::chrono::microseconds>(start - _last_redraw).count() /
+    //                  1000);
+    _last_redraw = now;
+  }
+
+  redraw();
+  glfw_throw_error();
+  auto presented = std::chrono::steady_clock::now();
+  _frame_scheduler.presented(now, presented);
+  perf::global().frames.record(presented - now);
+  _input_presented();
+
+  if (!std::exchange(_first_frame_presented, true)) {
+    auto elapsed = perf::startup_step("first frame presented");
+    perf::global().first_frame_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+                                        std::memory_order_relaxed);
+  }
+}
+
+void bar::_input_presented() {
+  // Still waiting for the tooltip's frame callback.
+  if (!_input_at || _tooltip_dirty)
+    return;
+  perf::global().input_latency.record(std::chrono::steady_clock::now() - *std::exchange(_input_at, std::nullopt));
+}
+
+// The UI thread only handles events, so a slow frame never holds up input and
+// a flood of input never holds up a frame.
 void bar::_ui_loop(std::stop_token token) {
   try {
-    while (true) {
-      if (token.stop_requested())
-        break;
+    while (!token.stop_requested()) {
+      glfwWaitEvents();
+      perf::global().ui_wakeups.fetch_add(1, std::memory_order_relaxed);
+
+      if (_tooltip_window_pending())
+        _create_tooltip_window();
+      _move_tooltip_window();
+
+      // Frame callbacks are dispatched here too.
+      bool presented = _frame_pacer.take_presented();
+      presented |= _tooltip_frame_pacer.take_presented();
+      if (std::exchange(_events_for_renderer, false) || presented)
+        _wake_renderer();
+    }
+
+    // The render thread has to let go of the GL contexts first.
+    _render_thread.request_stop();
+    _render_thread.join();
+    _ui_terminate();
+  } catch (std::exception &e) {
+    fmt::print(error, "Exception in UI loop: {}\n", e.what());
+    std::exit(1);
+  }
+}
+
+// Owns the GL contexts, draws whenever _render_wait says so.
+void bar::_render_loop(std::stop_token token) {
+  try {
+    _ui_use_fonts();
+    while (!token.stop_requested()) {
+      _ui_frame(std::chrono::steady_clock::now());
+      _render_wait(token);
+    }
 
-      {
-        auto now = std::chrono::steady_clock::now();
+    _render_terminate();
+  } catch (std::exception &e) {
+    fmt::print(error, "Exception in render loop: {}\n", e.what());
+    std::exit(1);
+  }
+}
+
+void bar::_render_terminate() {
+  _frame_pacer.reset();
+  _tooltip_frame_pacer.reset();
+
+  // Free drawers
+  _window.~gwindow();
+  _tooltip_window.~gwindow();
+
+  glfwMakeContextCurrent(nullptr);
+}
+
+void bar::_ui_terminate() { glfwTerminate(); }
 
-        auto delta = now - _last_redraw;
-        for (auto &block : _left_blocks)
-          block.block->animate(delta);
-        for (auto &block : _right_blocks)
-          block.block->animate(delta);
+void bar::_ui_attach_to_loop() {
+  auto *loop = uv_default_loop();
+
+  int fd = glfwGetPlatform() == GLFW_PLATFORM_X11 ? ConnectionNumber(glfwGetX11Display())
+                                                  : wl_display_get_fd(glfwGetWaylandDisplay());
+  uv_poll_init(loop, &_display_poll, fd);
+  uv_poll_start(&_display_poll, UV_READABLE, [](uv_poll_t *, int, int) {
+    perf::global().ui_wakeups.fetch_add(1, std::memory_order_relaxed);
+    glfwPollEvents();
+  });
 
-        // fmt::println(debug, "Redrawing! ({:>6.3f}ms elapsed since last redraw)",
-        //              (double)std::chrono::duration_cast<std::chrono::microseconds>(start - _last_redraw).count() /
-        //                  1000);
-        _last_redraw = now;
-      }
+  // Xlib and libwayland may have read events into their queues while we were
+  // doing something else, the fd won't become readable for those. This also
+  // flushes whatever requests we made before the loop goes to sleep.
+  uv_prepare_init(loop, &_ui_prepare);
+  uv_prepare_start(&_ui_prepare, [](uv_prepare_t *) { glfwPollEvents(); });
 
-      redraw();
-      glfw_throw_error();
-      _redraw_requested.store(true, std::memory_order_release);
+  // Runs after the loop thread handled timers and I/O, so a frame includes
+  // every block update that happened in this loop iteration.
+  uv_check_init(loop, &_ui_check);
+  uv_check_start(&_ui_check, [](uv_check_t *) { bar::instance()._ui_tick(); });
 
-      _hovered_block_threatened = 0;
+  // Only there to wake the loop up for the next frame deadline, _ui_tick does the rest.
+  uv_timer_init(loop, &_frame_timer);
 
-      _ui_process_events(token, _last_redraw + 48ms);
+  _ui_use_fonts();
+  _ui_on_loop = true;
+  schedule_redraw();
+}
 
-      if (_hovered_block_threatened == 0b01)
-        _hovered_block = nullptr;
+void bar::_ui_tick() {
+  try {
+    auto now = std::chrono::steady_clock::now();
+    auto wakeup = _ui_wakeup(now);
 
-      if (_hovered_block_threatened & 0b100)
-        _redraw_requested.store(true, std::memory_order_release);
+    if (wakeup && now >= *wakeup) {
+      _ui_frame(now);
+      now = std::chrono::steady_clock::now();
+      wakeup = _ui_wakeup(now);
     }
 
-    // Free drawers
-    _window.~gwindow();
-    _tooltip_window.~gwindow();
+    if (!wakeup) {
+      uv_timer_stop(&_frame_timer);
+      return;
+    }
 
-    glfwTerminate();
+    // uv_timer_start takes whole milliseconds, never round down to a wakeup
+    // that would be too early to draw anything.
+    auto timeout = std::chrono::ceil<std::chrono::milliseconds>(*wakeup - now);
+    uv_timer_start(
+        &_frame_timer, [](uv_timer_t *) { perf::global().ui_wakeups.fetch_add(1, std::memory_order_relaxed); },
+        std::max<std::int64_t>(timeout.count(), 0), 0);
   } catch (std::exception &e) {
     fmt::print(error, "Exception in UI loop: {}\n", e.what());
     std::exit(1);
@@ -208,87 +674,101 @@ void bar::_ui_loop(std::stop_token token) {
 }
 
 void bar::redraw() {
-  std::size_t x = 5;
-
   auto now = std::chrono::steady_clock::now();
   auto &direct_draw = _window.drawer();
-  auto buffered_draw = BufDraw(direct_draw);
 
   glfwMakeContextCurrent(_window);
+  direct_draw.sync();
+  _input_x_scale.store(direct_draw.x_render_scale(), std::memory_order_relaxed);
+  _input_y_scale.store(direct_draw.y_render_scale(), std::memory_order_relaxed);
   glClear(GL_COLOR_BUFFER_BIT);
 
-  {
-    auto filtered = _left_blocks | std::views::filter([](BlockInfo const &info) { return !info.block->skip(); });
-    auto it = filtered.begin();
-    if (it != filtered.end())
-      while (true) {
-        auto &info = *it;
-        auto &block = info.block;
-        auto width = block->draw(buffered_draw, now - _last_redraw, x, false);
-        info.last_pos = {(unsigned)x, 0};
-        info.last_size = {(unsigned)width, _height};
-
-        buffered_draw.draw_offset(x, 0);
-        buffered_draw.clear();
-        x += width;
-
-        if (++it == filtered.end())
-          break;
-
-        x += 8;
-        direct_draw.frect(x, 3, 2, direct_draw.height() - 6, 0xD3D3D3);
-        x += 8 + 2;
-      }
+  auto record = [&](BlockInfo &info, bool right) {
+    if (!info.recording)
+      info.recording = std::make_unique<BufDraw>(direct_draw);
+    info.recording->clear();
+    perf::timing::scope measure(info.block->perf_stats().draw, config::watchdog::draw_budget);
+    return info.block->draw(*info.recording, now - _last_redraw, info.slot.x, right);
+  };
+
+  _layout.begin_frame();
+  for (auto &info : _left_blocks)
+    if (!info.block->skip())
+      _layout.add_left(&info, info.slot, record(info, false), now);
+  for (auto &info : _right_blocks | std::views::reverse)
+    if (!info.block->skip())
+      _layout.add_right(&info, info.slot, record(info, true), now);
+
+  if (_layout.finish(direct_draw.width())) {
+    _publish_hit_boxes();
+    // Blocks might have moved from under the cursor.
+    if (_cursor_pos)
+      _hovered_block = _hit_test(_cursor_pos->first, _cursor_pos->second);
   }
 
-  x = direct_draw.width() - 5;
+  using layout = decltype(_layout);
 
-  {
-    auto filtered = _right_blocks | std::views::reverse | std::views::filter([](BlockInfo const &info) { return !info.block->skip(); });
-    auto it = filtered.begin();
-    if (it != filtered.end())
-      while (true) {
-        auto &info = *it;
-        auto &block = info.block;
-        auto width = block->draw(buffered_draw, now - _last_redraw, x, true);
-        info.last_pos = {(unsigned)(x - width), 0};
-        info.last_size = {(unsigned)width, _height};
-
-        x -= width;
-        direct_draw.frect(x - 8, 0, width + 16, direct_draw.height(), config::background_color.as_rgb());
-        buffered_draw.draw_offset(x, 0);
-        buffered_draw.clear();
-
-        if (++it == filtered.end())
-          break;
-
-        if (it != filtered.begin()) {
-          x -= 8 + 2;
-          direct_draw.frect(x, 3, 2, direct_draw.height() - 6, 0xD3D3D3);
-          x -= 8;
-        }
-      }
+  for (auto const &entry : _layout.left()) {
+    entry.key->recording->draw_offset(entry.slot->x, 0);
+
+    if (&entry != &_layout.left().back())
+      direct_draw.frect(entry.slot->x + entry.width + layout::separator_margin, 3, layout::separator_width,
+                        direct_draw.height() - 6, 0xD3D3D3);
+  }
+
+  for (auto const &entry : _layout.right()) {
+    direct_draw.frect(entry.slot->x - layout::separator_margin, 0, entry.width + 2 * layout::separator_margin,
+                      direct_draw.height(), config::background_color.as_rgb());
+    entry.key->recording->draw_offset(entry.slot->x, 0);
+
+    if (&entry != &_layout.right().back())
+      direct_draw.frect(entry.slot->x - layout::separator_margin - layout::separator_width, 3,
+                        layout::separator_width, direct_draw.height() - 6, 0xD3D3D3);
   }
 
   glFlush();
-  glfwSwapBuffers(_window);
+  _frame_pacer.frame_requested();
+  _swap_buffers(_window);
 
+  _draw_tooltip(now);
+}
+
+void bar::_publish_hit_boxes() {
+  auto &boxes = _hit_boxes.back();
+  boxes.clear();
+  for (auto const &entry : _layout.left())
+    boxes.push_back({entry.slot->x, entry.slot->x + entry.width, entry.key->block.get()});
+  // Right blocks are laid out from the edge inwards, reversed they are sorted
+  // by position like the left ones, which is what _queue_input searches.
+  for (auto const &entry : _layout.right() | std::views::reverse)
+    boxes.push_back({entry.slot->x, entry.slot->x + entry.width, entry.key->block.get()});
+  _hit_boxes.publish();
+}
+
+void bar::_draw_tooltip(std::chrono::steady_clock::time_point now) {
   BlockInfo *hovered = _hovered_block;
-  if (hovered && hovered->block->has_tooltip()) {
+  if (hovered && hovered->block->ready() && hovered->block->has_tooltip()) {
+    if (!_tooltip_window_ready())
+      return;
+    // The previous tooltip frame hasn't been presented yet or the window is
+    // still being moved, we stay dirty and are woken up once it is done.
+    if (!_tooltip_frame_pacer.can_present() || _tooltip_moving.load(std::memory_order_acquire))
+      return;
+
     glfwMakeContextCurrent(_tooltip_window);
-    glClear(GL_COLOR_BUFFER_BIT);
+    _tooltip_window.drawer().sync();
 
     auto &block = hovered->block;
     auto &wd = _tooltip_window.drawer();
     auto bd = BufDraw(wd);
-    block->draw_tooltip(bd, now - _last_tooltip_draw, hovered->last_size.x);
+    block->draw_tooltip(bd, now - _last_tooltip_draw, hovered->slot.width);
 
     auto dim = bd.calculate_size();
     dim.x *= wd.x_render_scale(), dim.y *= wd.y_render_scale();
 
-    uvec2 pos{(uint32_t)(hovered->last_pos.x * wd.x_render_scale()) +
-                  (signed)(hovered->last_size.x * wd.x_render_scale() - dim.x - 16) / 2,
-              (unsigned)(hovered->last_pos.y * wd.y_render_scale() + _height)};
+    uvec2 pos{(uint32_t)(hovered->slot.x * wd.x_render_scale()) +
+                  (signed)(hovered->slot.width * wd.x_render_scale() - dim.x - 16) / 2,
+              (unsigned)_height};
     uvec2 size{dim.x + (unsigned)(16 * wd.x_render_scale()), dim.y + (unsigned)(16 * wd.y_render_scale())};
     uvec2 dsize = {(unsigned)_monitor_size.x, (unsigned)_monitor_size.y};
 
@@ -300,18 +780,28 @@ void bar::redraw() {
     if (pos.x > dsize.x)
       pos.x = 0;
 
-    glfwSetWindowPos(_tooltip_window, pos.x, pos.y);
-    glfwSetWindowSize(_tooltip_window, size.x, size.y);
+    // The window is moved and resized before a frame of its new size is drawn,
+    // and only shown once there is one.
+    if (_place_tooltip({pos, size, _tooltip_placement.visible}))
+      return;
+    _tooltip_dirty = false;
 
+    glClear(GL_COLOR_BUFFER_BIT);
     bd.draw_offset(8, 8);
 
     _last_tooltip_draw = now;
     glFlush();
-    glfwSwapBuffers(_tooltip_window);
+    _tooltip_frame_pacer.frame_requested();
+    _swap_buffers(_tooltip_window);
 
-    glfwShowWindow(_tooltip_window);
-  } else
-    glfwHideWindow(_tooltip_window);
+    _place_tooltip({pos, size, true});
+  } else {
+    _tooltip_dirty = false;
+    if (_tooltip_placement.visible)
+      _place_tooltip({_tooltip_placement.pos, _tooltip_placement.size, false});
+    // A hidden surface never gets its frame callback.
+    _tooltip_frame_pacer.reset();
+  }
 }
 
 void bar::join() {
@@ -3,10 +3,14 @@
 #include "ui/gl.hh"
 
 #include <chrono>
+#include <condition_variable>
+#include <future>
 #include <latch>
 #include <memory>
+#include <mutex>
 #include <ranges>
 #include <thread>
+#include <vector>
 
 #include <X11/X.h>
 #include <X11/Xlib.h>
@@ -17,55 +21,221 @@
 
 #include "block.hh"
 #include "bufdraw.hh"
+#include "frame_scheduler.hh"
+#include "layout.hh"
 #include "log.hh"
+#include "mpsc_queue.hh"
+#include "perf.hh"
+#include "power.hh"
+#include "snapshot.hh"
 #include "ui/draw.hh"
+#include "ui/frame_pacer.hh"
+#include "ui/visibility.hh"
 #include "ui/window.hh"
+#include "update_scheduler.hh"
 #include "util.hh"
+#include "watchdog.hh"
 
 class bar {
   struct BlockInfo {
     std::unique_ptr<Block> block;
 
-    uvec2 last_pos{0,0};
-    uvec2 last_size{0,0};
+    layout_slot slot;
+    // What the block drew in the last frame, replayed at the position
+    // assigned to it by the layout.
+    std::unique_ptr<BufDraw> recording;
 
     BlockInfo(std::unique_ptr<Block> &&block) : block(std::move(block)) {}
     BlockInfo(BlockInfo const &) = delete;
     BlockInfo(BlockInfo &&) = default;
     BlockInfo &operator=(BlockInfo const &) = delete;
     BlockInfo &operator=(BlockInfo &&) = delete;
+
+    BlockInfo &reserve(width_reservation reservation) {
+      slot.reservation = reservation;
+      return *this;
+    }
   };
 
+  // The UI thread only handles GLFW's events, frames are drawn on the render
+  // thread which owns the GL contexts. Neither exists with config::single_threaded.
   std::jthread _ui_thread;
-  std::atomic<bool> _redraw_requested;
+  std::jthread _render_thread;
+  std::mutex _render_mutex;
+  std::condition_variable_any _render_wakeup;
+  bool _render_woken = false;
+  frame_scheduler _frame_scheduler;
+  update_scheduler _update_scheduler;
+  power::monitor _power_monitor;
+  watchdog _watchdog;
   std::chrono::steady_clock::time_point _last_redraw;
+  int _swap_interval = 0;
+  // Loaded concurrently with the rest of startup, the UI waits for them before
+  // its first frame.
+  std::future<std::shared_ptr<ui::fonts>> _fonts_loading;
+  bool _first_frame_presented = false;
 
   ui::gwindow _window;
+  // Created the first time a tooltip is shown, see _tooltip_window_ready.
   ui::gwindow _tooltip_window;
+  std::atomic<bool> _tooltip_window_requested{false};
+  std::atomic<GLFWwindow *> _tooltip_glfw_window{nullptr};
+  // Set once the render thread made the window the UI thread created its own.
+  bool _tooltip_window_adopted = false;
+
+  // GLFW windows may only be moved, resized, shown and hidden on the thread
+  // handling events. The render thread decides where the tooltip goes, the UI
+  // thread puts it there and wakes the render thread up again.
+  struct tooltip_placement {
+    uvec2 pos{}, size{};
+    bool visible = false;
+
+    bool operator==(tooltip_placement const &) const = default;
+  };
+  std::mutex _tooltip_mutex;
+  std::optional<tooltip_placement> _tooltip_request;
+  // Set while a request hasn't been carried out yet, the tooltip isn't drawn
+  // for a size its window doesn't have yet.
+  std::atomic<bool> _tooltip_moving{false};
+  // The last placement asked for, only touched by the render thread.
+  tooltip_placement _tooltip_placement;
+  ui::frame_pacer _frame_pacer;
+  ui::frame_pacer _tooltip_frame_pacer;
+
+  // A combination of ui::hidden_reason bits, the bar isn't drawn at all while
+  // any of them is set.
+  std::atomic<unsigned> _hidden{0};
+  // Set when the bar becomes visible again, the render thread then holds off
+  // drawing until the loop thread has caught up on block updates.
+  std::atomic<bool> _catching_up{false};
+  uv_async_t _visibility_async;
+  ui::x11_visibility_monitor _visibility_monitor;
+
+  // With config::single_threaded there are no UI and render threads, the loop
+  // thread polls the display connection and draws frames after it handled its I/O.
+  bool _single_threaded = false;
+  bool _ui_on_loop = false;
+  uv_poll_t _display_poll;
+  uv_prepare_t _ui_prepare;
+  uv_check_t _ui_check;
+  uv_timer_t _frame_timer;
 
-  // Used to implement tooltip drawing
+  // Clicks and scrolling, queued by the UI thread for the loop thread which
+  // hands them to the blocks.
+  struct input_event {
+    Block *block = nullptr;
+    ui::draw::pos_t x = 0;
+    // One of GLFW_MOUSE_BUTTON_* for clicks, -1 for scrolling.
+    int button = -1;
+    double dx = 0, dy = 0;
+  };
+  mpsc_queue<input_event, 64> _input_queue;
+  uv_async_t _input_async;
+
+  // What the GLFW callbacks saw of the pointer since the render thread last
+  // looked, see _apply_pointer.
+  struct pointer_state {
+    // In bar coordinates, if it is over the bar.
+    std::optional<std::pair<double, double>> pos;
+    std::optional<std::chrono::steady_clock::time_point> moved_at;
+    // When it entered or left the bar or the tooltip first.
+    std::optional<std::chrono::steady_clock::time_point> crossed_at;
+    // Like _hovered_block_threatened, since the last motion.
+    int threatened = 0;
+    // When the first click or scroll happened.
+    std::optional<std::chrono::steady_clock::time_point> input_at;
+  };
+  std::mutex _pointer_mutex;
+  pointer_state _pointer;
+  // The render thread's scale, to convert the pointer position to bar coordinates.
+  std::atomic<float> _input_x_scale{1}, _input_y_scale{1};
+  // Set by the callbacks when the render thread has something to look at, only
+  // touched by the UI thread.
+  bool _events_for_renderer = false;
+
+  // Where the blocks were in the last frame sorted by begin, for the UI thread to
+  // hit test clicks.
+  struct hit_box {
+    ui::draw::pos_t begin = 0, end = 0;
+    Block *block = nullptr;
+  };
+  snapshot<std::vector<hit_box>> _hit_boxes;
+
+  // Used to implement tooltip drawing, only touched by the render thread.
   ivec2 _monitor_size;
   uint32_t _height;
   BlockInfo *_hovered_block;
   int _hovered_block_threatened;
-  std::chrono::time_point<std::chrono::steady_clock, std::chrono::duration<double>> _last_mouse_move;
+  // Last known cursor position in bar coordinates, if it is over the bar.
+  std::optional<std::pair<double, double>> _cursor_pos;
   std::chrono::time_point<std::chrono::steady_clock, std::chrono::duration<double>> _last_tooltip_draw;
+  // The hovered block changed or wants its tooltip redrawn.
+  bool _tooltip_dirty = false;
+  // When the oldest input that isn't reflected on screen yet arrived.
+  std::optional<std::chrono::steady_clock::time_point> _input_at;
 
   std::list<BlockInfo> _left_blocks;
   std::list<BlockInfo> _right_blocks;
+  bar_layout<BlockInfo *> _layout;
 
   void _ui_init();
-  void _ui_process_events(std::stop_token, std::chrono::steady_clock::time_point until);
+  void _ui_use_fonts();
+  bool _tooltip_window_ready();
+  bool _tooltip_window_pending() const;
+  void _create_tooltip_window();
+  bool _place_tooltip(tooltip_placement const &);
+  void _move_tooltip_window();
+  void _apply_tooltip_placement(tooltip_placement const &);
+  void _pointer_crossed(bool entered, bool bar_window);
+  void _apply_pointer();
+  void _publish_hit_boxes();
+  // When the UI has to wake up next: now or earlier to draw a frame, nullopt if
+  // only an event can make it draw. _bar_wakeup only considers the bar itself.
+  std::optional<std::chrono::steady_clock::time_point> _bar_wakeup(std::chrono::steady_clock::time_point now);
+  std::optional<std::chrono::steady_clock::time_point> _ui_wakeup(std::chrono::steady_clock::time_point now);
+  bool _tooltip_pending() const;
+  void _input_received(std::chrono::steady_clock::time_point at) {
+    if (!_input_at)
+      _input_at = at;
+  }
+  void _input_presented();
+  void _wake_renderer() {
+    {
+      std::lock_guard lock(_render_mutex);
+      _render_woken = true;
+    }
+    _render_wakeup.notify_one();
+  }
+  void _render_wait(std::stop_token);
+  void _render_loop(std::stop_token);
+  void _render_terminate();
+  void _ui_frame(std::chrono::steady_clock::time_point now);
+  void _swap_buffers(GLFWwindow *);
+  void _draw_tooltip(std::chrono::steady_clock::time_point now);
   void _ui_loop(std::stop_token);
+  void _ui_terminate();
+  void _ui_attach_to_loop();
+  void _ui_tick();
   void _setup_block(BlockInfo &info);
+  void _apply_power_profile(power::profile const &);
+  // Safe to call from any thread.
+  void _set_hidden(ui::hidden_reason, bool);
+  void _on_visibility_changed();
+  // Called on the UI thread, never waits for the loop thread.
+  void _queue_input(int button, double dx, double dy);
+  void _dispatch_input();
+  BlockInfo *_hit_test(double x, double y) const;
 
   bar() {}
 
   ~bar() {
     if (_ui_thread.joinable()) {
       _ui_thread.request_stop();
-      schedule_redraw();
+      glfwPostEmptyEvent();
       _ui_thread.join();
+    } else if (_ui_on_loop) {
+      _render_terminate();
+      _ui_terminate();
     }
   }
 
@@ -79,17 +249,24 @@ public:
 
   ui::gwindow &window() { return _window; }
   ui::gwindow &tooltip_window() { return _tooltip_window; }
+  update_scheduler &updates() { return _update_scheduler; }
 
-  template <std::derived_from<Block> B, typename... Args> void add_left(Args &&...args) {
-    _setup_block(_left_blocks.emplace_back(BlockInfo(std::make_unique<B>(std::forward<Args>(args)...))));
+  template <std::derived_from<Block> B, typename... Args> BlockInfo &add_left(Args &&...args) {
+    auto &info = _left_blocks.emplace_back(BlockInfo(std::make_unique<B>(std::forward<Args>(args)...)));
+    _setup_block(info);
+    return info;
   }
-  template <std::derived_from<Block> B, typename... Args> void add_right(Args &&...args) {
-    _setup_block(_right_blocks.emplace_back(BlockInfo(std::make_unique<B>(std::forward<Args>(args)...))));
+  template <std::derived_from<Block> B, typename... Args> BlockInfo &add_right(Args &&...args) {
+    auto &info = _right_blocks.emplace_back(BlockInfo(std::make_unique<B>(std::forward<Args>(args)...)));
+    _setup_block(info);
+    return info;
   };
 
   void schedule_redraw() {
-    if (!_redraw_requested.exchange(true, std::memory_order_acq_rel))
-      glfwPostEmptyEvent();
+    // Without a render thread the frame is drawn once the loop thread is done
+    // with whatever it is doing now, nothing has to be woken up.
+    if (_frame_scheduler.request() && !_single_threaded)
+      _wake_renderer();
   }
 
   void redraw();
@@ -98,9 +275,33 @@ public:
     _ui_init();
   }
 
+  // Must be called from the thread that will run the libuv loop.
   void start_ui() {
+    perf::global().register_loop_thread();
+    _power_monitor.start([this](power::profile const &profile) { _apply_power_profile(profile); });
+    _watchdog.start();
+
+    uv_async_init(uv_default_loop(), &_visibility_async,
+                  [](uv_async_t *) { bar::instance()._on_visibility_changed(); });
+    uv_unref((uv_handle_t *)&_visibility_async);
+    uv_async_init(uv_default_loop(), &_input_async, [](uv_async_t *) { bar::instance()._dispatch_input(); });
+    uv_unref((uv_handle_t *)&_input_async);
+    _visibility_monitor.start(_window, [this](ui::hidden_reason reason, bool hidden) { _set_hidden(reason, hidden); });
+
+    if (_single_threaded) {
+      _ui_attach_to_loop();
+      return;
+    }
+
+    _render_thread = std::jthread([this](std::stop_token st) {
+      perf::global().register_render_thread();
+      _render_loop(st);
+    });
+
     std::latch ui_ready_latch(1);
     _ui_thread = std::jthread([this, &ui_ready_latch](std::stop_token st) {
+      perf::global().register_ui_thread();
+
       uv_async_t handle;
       uv_async_init(uv_default_loop(), &handle, [](uv_async_t *) {});
 
@@ -112,6 +313,18 @@ public:
     ui_ready_latch.wait();
   }
 
+  // Also visits the blocks that are part of another one, see Block::for_each_part.
+  template <typename F> void for_each_block(F &&f) const {
+    auto visit = [&f](Block &block) {
+      f(block);
+      block.for_each_part([&f](Block &part) { f(part); });
+    };
+    for (auto const &info : _left_blocks)
+      visit(*info.block);
+    for (auto const &info : _right_blocks)
+      visit(*info.block);
+  }
+
   size_t on_x11_event(std::function<void(XEvent *)> callback) { return _x11_event_callbacks.emplace(callback); }
   void off_x11_event(size_t handle) { _x11_event_callbacks.remove(handle); }
 
@@ -1,16 +1,22 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <cstddef>
+#include <functional>
 #include <optional>
 #include <stdexcept>
 #include <uv.h>
 
 #include "bufdraw.hh"
+#include "co.hh"
 #include "log.hh"
+#include "perf.hh"
 #include "ui/draw.hh"
 
 class Block {
+  mutable perf::block_stats _perf_stats;
+
 public:
   Block() = default;
   virtual ~Block() = default;
@@ -26,18 +32,37 @@ public:
   virtual bool skip() { return false; }
   virtual void delay_draw() {}
   virtual void animate(Interval) {}
+  // Calls f with every block drawn as part of this one. They are still updated
+  // on their own, so the watchdog and the perf block look at them one by one.
+  virtual void for_each_part(std::function<void(Block &)> const &) {}
 
   virtual size_t draw(ui::draw &, std::chrono::duration<double>, size_t, bool) = 0;
 
+  // Called with the cursor position relative to the block while it is being
+  // hovered over, should return true if the tooltip needs to be redrawn.
+  virtual bool hover(ui::draw::pos_t) { return false; }
+  // Called on the loop thread when the block was clicked (button is one of
+  // GLFW_MOUSE_BUTTON_*) or scrolled over, with x relative to the block. Scroll
+  // offsets are GLFW's, positive is up and right, bursts of them are summed up
+  // into a single call.
+  virtual void click(ui::draw::pos_t, int) {}
+  virtual void scroll(ui::draw::pos_t, double, double) {}
+
+  // Whether the block has something to show yet, its tooltip isn't shown before.
+  virtual bool ready() const { return true; }
   virtual bool has_tooltip() const { return false; }
   virtual void draw_tooltip(ui::draw &, std::chrono::duration<double>, unsigned) const {
     throw std::logic_error("Block::draw_tooltip called but not implemented");
   };
+
+  perf::block_stats &perf_stats() const { return _perf_stats; }
 };
 
 class SimpleBlock : public Block {
-protected:
-  uv_timer_t _update_timer;
+  std::atomic<bool> _stale{false};
+  // Set once the first update finished, see ready().
+  std::atomic<bool> _ready{false};
+  friend class update_scheduler;
 
 public:
   SimpleBlock() = default;
@@ -51,17 +76,54 @@ public:
 
   virtual size_t draw(ui::draw &, std::chrono::duration<double> delta) = 0;
 
-  size_t draw(ui::draw &draw, std::chrono::duration<double> delta, size_t, bool right) override {
-    if (right)
-      return this->draw(draw, delta);
-    else
-      return this->draw(draw, delta);
+  size_t draw(ui::draw &draw, std::chrono::duration<double> delta, size_t, bool) override {
+    if (!ready())
+      return draw_placeholder(draw);
+    auto width = this->draw(draw, delta);
+    if (stale())
+      width += 5 + draw.text(width + 5, "stale", 0x888888);
+    return width;
   }
 
   virtual void update(){};
+  // How often update() should be called, see update_scheduler for how this is
+  // rounded.
   virtual Interval update_interval() { return Interval::max(); };
+  // How far the update interval may be stretched while the block's output stays
+  // the same (needs_redraw() returns false), by default it is never stretched.
+  virtual Interval max_update_interval() { return update_interval(); }
+  // Whether the last update() changed anything that's visible, if not then no
+  // redraw will be scheduled after it.
+  virtual bool needs_redraw() { return true; }
+  // Whether update() can block for a long time (a hung network filesystem...).
+  // Such updates run on a worker thread, so update() and draw() have to be safe
+  // to call concurrently.
+  virtual bool update_may_block() { return false; }
+  // Whether update() is as safe to run on a worker thread as that of a block whose
+  // updates may block. The watchdog moves the updates of such blocks there when
+  // they keep going over their budget.
+  virtual bool update_may_move() { return false; }
+  // Set while an update that may block has been running for too long, the
+  // block is then drawn with its last values and marked as stale.
+  bool stale() const { return _stale.load(std::memory_order_relaxed); }
+  // Periodically updated blocks get their first update from the update
+  // scheduler after startup, until it finished they are drawn as a placeholder
+  // and draw(ui::draw &, ...) isn't called.
+  bool ready() const override { return _ready.load(std::memory_order_acquire); }
+  static size_t draw_placeholder(ui::draw &draw) { return draw.text(0, "…", 0x888888); }
 
   void setup() final override;
 
   void delay_draw() override{};
 };
+
+// A block that samples asynchronously (runs processes, reads files through
+// libuv...) by implementing its update as a coroutine on the loop thread, see
+// co.hh. The update scheduler starts the next update only after the previous
+// one finished, and asks needs_redraw() once it has.
+class AsyncBlock : public SimpleBlock {
+public:
+  virtual co::task<> update_async() = 0;
+  // Never does anything, update_async() is run instead.
+  void update() final override {}
+};
@@ -1,99 +1,112 @@
 #include <chrono>
 #include <cmath>
 #include <cstddef>
-#include <fstream>
+#include <cstdlib>
 #include <iomanip>
 #include <optional>
 #include <string>
 
 #include <fmt/core.h>
 
+#include "../bar.hh"
 #include "../log.hh"
+#include "../power.hh"
 #include "../util.hh"
 #include "battery.hh"
 
-BatteryBlock::BatteryBlock(std::filesystem::path path, BatteryBlock::Config config) : _path(path), _config(config) {}
-BatteryBlock::~BatteryBlock() {}
-
-static size_t read_int(std::filesystem::path path) {
-  std::ifstream ifs(path);
-  if (!ifs.is_open())
-    throw std::runtime_error("Could not open file");
-  std::string line;
-  std::getline(ifs, line);
-  // Happens right after unplugging or plugging in the battery.
-  if (line.empty())
-    return 0;
-  return std::stoul(line);
+BatteryBlock::BatteryBlock(std::filesystem::path path, BatteryBlock::Config config)
+    : _status(path / "status"), _charge_now(path / "charge_now"), _charge_full(path / "charge_full"),
+      _charge_full_design(path / "charge_full_design"), _current_now(path / "current_now"),
+      _voltage_now(path / "voltage_now"), _energy_now(path / "energy_now"), _energy_full(path / "energy_full"),
+      _energy_full_design(path / "energy_full_design"), _power_now(path / "power_now"),
+      _charge_control_end_threshold(path / "charge_control_end_threshold"), _config(config) {
+  if (!_status.exists())
+    throw std::runtime_error("Could not open battery status file");
+  _uevents.start("power_supply", {"change"}, [this] { bar::instance().updates().trigger(*this); });
 }
+BatteryBlock::~BatteryBlock() {}
 
-static double read_micro(std::filesystem::path path) { return (double)read_int(path) / 1000000.; }
+// Values are empty right after unplugging or plugging in the battery. Some
+// drivers report the current as negative while discharging.
+static double read_number(sysfs_attr &attr) { return (double)std::abs(attr.number().value_or(0)); }
+static double read_micro(sysfs_attr &attr) { return read_number(attr) / 1000000.; }
 
 std::optional<BatteryBlock> BatteryBlock::find_first(Config config) {
-  for (auto &entry : std::filesystem::directory_iterator("/sys/class/power_supply")) {
-    if (entry.path().filename() == "BAT0") {
-      return std::make_optional<BatteryBlock>(entry.path(), config);
-    }
-  }
-  return {};
+  auto batteries = power::find_supplies("Battery");
+  if (batteries.empty())
+    return {};
+  return std::make_optional<BatteryBlock>(batteries.front(), config);
 }
 
 void BatteryBlock::update() {
-  std::ifstream ifs(_path / "status");
-  if (!ifs.is_open())
-    throw std::runtime_error("Could not open battery status file");
-  std::string line;
-  std::getline(ifs, line);
-  _charging = line == "Charging";
-  _full = line == "Full";
+  Reading reading{};
+
+  auto status = _status.text();
+  if (!status)
+    throw std::runtime_error("Could not read battery status");
+  reading.charging = *status == "Charging";
+  reading.full = *status == "Full";
 
-  if (std::filesystem::exists(_path / "charge_now")) {
+  if (_charge_now.exists()) {
     // case 1 = charge is available
-    size_t charge_now = read_int(_path / "charge_now");
-    size_t charge_full = read_int(_path / "charge_full");
-    size_t charge_full_design = read_int(_path / "charge_full_design");
-    size_t current_now = read_int(_path / "current_now");
-    size_t voltage_now = read_int(_path / "voltage_now");
+    double charge_now = read_number(_charge_now);
+    double charge_full = read_number(_charge_full);
+    double charge_full_design = read_number(_charge_full_design);
+    double current_now = read_number(_current_now);
+    double voltage_now = read_number(_voltage_now);
 
-    _charge_level = (double)charge_now / charge_full;
-    _wattage_now = (voltage_now / 1000. / 1000.) * (current_now / 1000. / 1000.);
+    reading.charge_level = charge_now / charge_full;
+    reading.wattage_now = (voltage_now / 1000. / 1000.) * (current_now / 1000. / 1000.);
 
-    if (_charging)
-      _seconds_left = (double)(charge_full - charge_now) / current_now * 3600;
+    if (reading.charging)
+      reading.seconds_left = (charge_full - charge_now) / current_now * 3600;
     else
-      _seconds_left = (double)charge_now / current_now * 3600;
+      reading.seconds_left = charge_now / current_now * 3600;
 
-    _degradation = (double)charge_full / charge_full_design * 100.;
-  } else if (std::filesystem::exists(_path / "energy_now")) {
+    reading.degradation = charge_full / charge_full_design * 100.;
+  } else if (_energy_now.exists()) {
     // case 2 = energy is available
-    double energy_now = read_micro(_path / "energy_now");
-    double energy_full = read_micro(_path / "energy_full");
-    double energy_full_design = read_micro(_path / "energy_full_design");
-    double power_now = read_micro(_path / "power_now");
+    double energy_now = read_micro(_energy_now);
+    double energy_full = read_micro(_energy_full);
+    double energy_full_design = read_micro(_energy_full_design);
+    double power_now = read_micro(_power_now);
 
-    _charge_level = energy_now / energy_full;
-    _wattage_now = power_now;
+    reading.charge_level = energy_now / energy_full;
+    reading.wattage_now = power_now;
 
-    if (_charging)
-      _seconds_left = (energy_full - energy_now) / power_now * 3600;
+    if (reading.charging)
+      reading.seconds_left = (energy_full - energy_now) / power_now * 3600;
     else
-      _seconds_left = energy_now / power_now * 3600;
+      reading.seconds_left = energy_now / power_now * 3600;
 
-    _degradation = energy_full / energy_full_design * 100.;
+    reading.degradation = energy_full / energy_full_design * 100.;
   } else {
     // case 3 = we don't have enough (or don't know where to look)
     // TODO: Display an error
   }
 
-  if (std::filesystem::exists(_path / "charge_control_end_threshold"))
-    _max_charge_level = (double)read_int(_path / "charge_control_end_threshold") / 100.;
+  if (_charge_control_end_threshold.exists())
+    reading.max_charge_level = read_number(_charge_control_end_threshold) / 100.;
   else
-    _max_charge_level = 1.0;
+    reading.max_charge_level = 1.0;
+
+  Visible visible{
+      .charging = reading.charging,
+      .full = reading.full,
+      .permille = std::lround(map_range(reading.charge_level, 0, reading.max_charge_level, 0, 1000)),
+      .deciwatts = std::lround(reading.wattage_now * 10),
+      .degradation = std::lround(reading.degradation * 10),
+  };
+  _changed = visible != _visible;
+  _visible = visible;
+
+  _reading.publish(reading);
 }
 
 void BatteryBlock::animate(Interval delta) {
-  if (_charging) {
-    size_t w = size_t(map_range(_charge_level, 0, _max_charge_level, 0, (_config.bar_width - 1) * 20));
+  auto const &reading = _reading.read();
+  if (reading.charging) {
+    size_t w = size_t(map_range(reading.charge_level, 0, reading.max_charge_level, 0, (_config.bar_width - 1) * 20));
     if (w)
       _charging_gradient_offset =
           (_charging_gradient_offset + std::chrono::duration_cast<std::chrono::nanoseconds>(delta).count() / 2500000) %
@@ -104,7 +117,8 @@ void BatteryBlock::animate(Interval delta) {
 }
 
 size_t BatteryBlock::draw(ui::draw &draw, std::chrono::duration<double>) {
-  double battery_percent = map_range(_charge_level, 0, _max_charge_level, 0, 100);
+  auto const &reading = _reading.read();
+  double battery_percent = map_range(reading.charge_level, 0, reading.max_charge_level, 0, 100);
   size_t x = 0;
 
   x += draw.text(x, draw.vcenter(), _config.prefix, _config.prefix_color);
@@ -114,7 +128,7 @@ size_t BatteryBlock::draw(ui::draw &draw, std::chrono::duration<double>) {
   x += 5;
 
   if (_config.show_wattage)
-    x += draw.text(x, draw.vcenter(), fmt::format("{:>4.1f}W", _wattage_now));
+    x += draw.text(x, draw.vcenter(), fmt::format("{:>4.1f}W", reading.wattage_now));
 
   x += 5;
 
@@ -158,27 +172,24 @@ size_t BatteryBlock::draw(ui::draw &draw, std::chrono::duration<double>) {
   };
 
   // If charging then fill the box with a gradient
-  if (_charging) {
+  if (reading.charging) {
     for (size_t i = 0; i < fill_width; ++i) {
       auto color = (155 + (unsigned long)((double)i / fill_width * 100)) << 8;
       auto x = left + ((i + _charging_gradient_offset / 10) % fill_width);
       draw.frect(x, top, 1, height, color);
     }
 
-    if (_config.show_time_left_charging && !_full) {
-      auto time_left_str = format_time(_seconds_left);
+    if (_config.show_time_left_charging && !reading.full) {
+      auto time_left_str = format_time(reading.seconds_left);
       draw.text(left + width / 2 - draw.textw(time_left_str) / 2, draw.vcenter(), time_left_str);
     }
   } else {
-    // 0-100 in HSL is the Red-Green range so we can act as if battery_percent
-    // is in the HSL hue range and then just map it to a percentage
-    auto hue = map_range(battery_percent, 0, 360, 0, 1);
-    color fill_color = color::hsl(hue, .9, .45);
+    color fill_color = gradients::level(battery_percent / 100);
 
     draw.frect(left, top, fill_width, height, fill_color);
 
-    if (_config.show_time_left_discharging && !_full && _wattage_now > 0) {
-      auto time_left_str = format_time(_seconds_left);
+    if (_config.show_time_left_discharging && !reading.full && reading.wattage_now > 0) {
+      auto time_left_str = format_time(reading.seconds_left);
       draw.text(left + width / 2 - draw.textw(time_left_str) / 2, draw.vcenter(), time_left_str);
     }
   }
@@ -187,7 +198,7 @@ size_t BatteryBlock::draw(ui::draw &draw, std::chrono::duration<double>) {
 
   if (_config.show_degradation) {
     x += 5;
-    x += draw.text(x, draw.vcenter(), fmt::format("{:5>.1f}%", _degradation));
+    x += draw.text(x, draw.vcenter(), fmt::format("{:5>.1f}%", reading.degradation));
   }
 
   return x;
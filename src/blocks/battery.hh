@@ -7,6 +7,9 @@
 #include <optional>
 
 #include "../block.hh"
+#include "../snapshot.hh"
+#include "../sysfs_attr.hh"
+#include "../uevent_monitor.hh"
 
 // Fuck xlib for defining a "Status" macro
 enum class BatteryStatus {
@@ -19,14 +22,34 @@ enum class BatteryStatus {
 
 class BatteryBlock final : public SimpleBlock {
 private:
-  std::filesystem::path _path;
-  // size_t _charge_full, _charge_full_design, _charge_now;
-  // size_t _current_now, _voltage_now;
-  double _charge_level, _max_charge_level, _wattage_now, _degradation;
-  size_t _seconds_left;
-  bool _charging, _full;
+  sysfs_attr _status;
+  // Batteries report either their charge (µAh) and current or their energy
+  // (µWh) and power.
+  sysfs_attr _charge_now, _charge_full, _charge_full_design, _current_now, _voltage_now;
+  sysfs_attr _energy_now, _energy_full, _energy_full_design, _power_now;
+  sysfs_attr _charge_control_end_threshold;
+  // The status attribute can't be polled, the kernel announces changes (being
+  // plugged in, the battery running full...) with uevents instead.
+  uevent_monitor _uevents;
+  struct Reading {
+    double charge_level, max_charge_level, wattage_now, degradation;
+    size_t seconds_left;
+    bool charging, full;
+  };
+  snapshot<Reading> _reading;
   size_t _charging_gradient_offset;
 
+  // The displayed values rounded like they are displayed, the time left is
+  // derived from the same readings so it is not tracked separately.
+  struct Visible {
+    bool charging, full;
+    long permille, deciwatts, degradation;
+
+    bool operator==(Visible const &) const = default;
+  };
+  Visible _visible{};
+  bool _changed = true;
+
 public:
   struct Config {
     std::string prefix{};
@@ -38,6 +61,8 @@ public:
     size_t bar_width = 70;
     bool show_wattage = true;
     bool show_degradation = false;
+    // The update interval is stretched up to this while the readings don't change.
+    Interval max_update_interval = std::chrono::seconds(16);
   };
 
 private:
@@ -56,4 +81,7 @@ public:
   Interval update_interval() override {
     return std::chrono::milliseconds(1000);
   }
+  Interval max_update_interval() override { return _config.max_update_interval; }
+  bool needs_redraw() override { return _changed; }
+  bool update_may_move() override { return true; }
 };
@@ -7,7 +7,6 @@
 #include <iterator>
 #include <optional>
 #include <ranges>
-#include <set>
 #include <sstream>
 #include <string_view>
 #include <vector>
@@ -17,189 +16,285 @@
 #include "../util.hh"
 #include "cpu.hh"
 
-CpuBlock::CpuBlock(Config config) : _config(config) { this->_current = this->read_cpu_times(); }
+CpuBlock::CpuBlock(Config config) : _config(config) {
+  if (_config.thermal_zone_type)
+    _thermal_uevents.start("thermal", {"add", "remove"},
+                           [this] { _thermal_zones_changed.store(true, std::memory_order_relaxed); });
+}
 CpuBlock::~CpuBlock() {}
 
-CpuBlock::AllTimes CpuBlock::read_cpu_times() {
-  std::ifstream stat("/proc/stat");
-
-  AllTimes all;
-  std::string name;
-  stat >> name;
-  stat >> all.total.user;
-  stat >> all.total.nice;
-  stat >> all.total.system;
-  stat >> all.total.idle;
-  stat >> all.total.iowait;
-  stat >> all.total.irq;
-  stat >> all.total.softirq;
-  stat >> all.total.steal;
-  stat >> all.total.guest;
-  stat >> all.total.guest_nice;
-
-  while (stat >> name && name.starts_with("cpu")) {
-    Times t;
-    stat >> t.user;
-    stat >> t.nice;
-    stat >> t.system;
-    stat >> t.idle;
-    stat >> t.iowait;
-    stat >> t.irq;
-    stat >> t.softirq;
-    stat >> t.steal;
-    stat >> t.guest;
-    stat >> t.guest_nice;
-    all.percore.push_back(std::move(t));
-  }
+// Groups are numbered in the order their first core is listed in.
+void CpuBlock::find_topology(std::vector<std::uint32_t> const &ids) {
+  _topology.ids = ids;
+  _topology.group_of.clear();
+  _topology.labels.clear();
+
+  auto read = [](std::filesystem::path const &path) { return (std::uint32_t)sysfs_attr(path).number().value_or(0); };
+  // What identifies a group, a core also needs its socket.
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> keys;
+  for (auto id : ids) {
+    auto cpu = std::filesystem::path("/sys/devices/system/cpu") / fmt::format("cpu{}", id);
+    std::pair<std::uint32_t, std::uint32_t> key{id, 0};
+    std::uint32_t label = id;
+    switch (_config.grouping) {
+    case Grouping::none:
+      break;
+    case Grouping::smt:
+      key = {read(cpu / "topology" / "physical_package_id"), read(cpu / "topology" / "core_id")};
+      break;
+    case Grouping::socket:
+      label = read(cpu / "topology" / "physical_package_id");
+      key = {label, 0};
+      break;
+    case Grouping::numa:
+      // The node shows up as a nodeN link, without NUMA there is none.
+      label = 0;
+      for (auto const &entry : std::filesystem::directory_iterator(cpu)) {
+        auto name = entry.path().filename().string();
+        if (name.starts_with("node") && name.size() > 4) {
+          label = std::stoul(name.substr(4));
+          break;
+        }
+      }
+      key = {label, 0};
+      break;
+    }
 
-  return all;
+    auto it = std::ranges::find(keys, key);
+    if (it == keys.end()) {
+      keys.push_back(key);
+      _topology.labels.push_back(_config.grouping == Grouping::smt ? (std::uint32_t)_topology.labels.size() : label);
+      it = keys.end() - 1;
+    }
+    _topology.group_of.push_back(it - keys.begin());
+  }
 }
 
-void CpuBlock::update() {
-  std::unique_lock lg(_update_mutex);
+// If several zones have the configured type the last one wins.
+void CpuBlock::find_thermal_zone() {
+  _thermal_zone.reset();
 
-  this->_previous = this->_current;
-  this->_current = this->read_cpu_times();
+  for (auto entry : std::filesystem::directory_iterator("/sys/class/thermal/")) {
+    if (!entry.path().filename().string().starts_with("thermal_zone"))
+      continue;
 
-  _diff = this->_current - this->_previous;
+    {
+      auto type_path = entry.path() / "type";
+      std::ifstream type_file(type_path);
+      std::string type;
+      type_file >> type;
 
-  if (_config.thermal_zone_type) {
-    for (auto entry : std::filesystem::directory_iterator("/sys/class/thermal/")) {
-      if (!entry.path().filename().string().starts_with("thermal_zone"))
+      if (type != _config.thermal_zone_type)
         continue;
+    }
 
-      {
-        auto type_path = entry.path() / "type";
-        std::ifstream type_file(type_path);
-        std::string type;
-        type_file >> type;
+    auto &zone = _thermal_zone.emplace(ThermalZone{.temp = sysfs_attr(entry.path() / "temp"), .trip_points = {}});
 
-        if (type != _config.thermal_zone_type)
-          continue;
-      }
+    for (auto const &point_entry : std::filesystem::directory_iterator(entry.path())) {
+      auto name = point_entry.path().filename().string();
+      if (!name.starts_with("trip_point_") || !name.ends_with("_type"))
+        continue;
 
-      _thermal = ThermalInfo();
-      {
-        auto temp_path = entry.path() / "temp";
-        std::ifstream temp_file(temp_path);
-        temp_file >> _thermal->temperature;
-      }
+      auto path = point_entry.path().string();
+      // remove _type
+      path.erase(path.size() - 5);
 
-      class trip_point_temperature_less {
-      public:
-        bool operator()(const ThermalInfo::TripPoint &a, const ThermalInfo::TripPoint &b) const {
-          return a.temperature < b.temperature;
-        }
-      };
-
-      auto point_range = std::ranges::subrange(std::filesystem::directory_iterator(entry.path()),
-                                               std::filesystem::directory_iterator()) |
-                         std::views::filter([](const auto &entry) {
-                           auto n = entry.path().filename().string();
-                           return n.starts_with("trip_point_") && n.ends_with("_type");
-                         }) |
-                         std::views::transform([](const auto &entry) {
-                           auto f = entry.path().string();
-                           // remove _type
-                           return f.erase(f.size() - 5);
-                         }) |
-                         std::views::transform([](const auto &path) {
-                           ThermalInfo::TripPoint point;
-
-                           std::ifstream(path + "_temp") >> point.temperature;
-                           std::ifstream(path + "_type") >> point.type;
-                           std::ifstream(path + "_hyst") >> point.hyst;
-
-                           return point;
-                         });
-
-      std::set<ThermalInfo::TripPoint, trip_point_temperature_less> points;
-      for (auto point : point_range)
-        points.emplace(std::move(point));
-
-      auto it =
-          std::ranges::find_if(points, [&](const auto &point) { return point.temperature < _thermal->temperature; });
+      ThermalInfo::TripPoint point;
+      std::ifstream(path + "_temp") >> point.temperature;
+      std::ifstream(path + "_type") >> point.type;
+      std::ifstream(path + "_hyst") >> point.hyst;
+      zone.trip_points.push_back(std::move(point));
+    }
+
+    auto by_temperature = [](auto const &a, auto const &b) { return a.temperature < b.temperature; };
+    std::ranges::stable_sort(zone.trip_points, by_temperature);
+    auto duplicates = std::ranges::unique(zone.trip_points, {}, &ThermalInfo::TripPoint::temperature);
+    zone.trip_points.erase(duplicates.begin(), duplicates.end());
+  }
+}
+
+// May run on a worker thread: always when a thermal zone is read (which may
+// block), otherwise after the watchdog moved the updates there. That is why the
+// results are handed to draw() through _shown.
+void CpuBlock::update() {
+  // Updated again before the shared sample got too old (triggered, the bar was
+  // shown again...), a sample of our own is taken to compare with.
+  auto current = samplers::proc_stat().get();
+  if (current == _previous)
+    current = samplers::proc_stat().get(std::chrono::steady_clock::duration::zero());
+
+  // Filled in place, the snapshot's buffers keep their storage. The first
+  // update shows the averages since boot.
+  auto &shown = _shown.back();
+  if (_previous)
+    current->value.difference(_previous->value, shown.diff);
+  else
+    shown.diff = current->value;
+  _previous = std::move(current);
+  auto &thermal = shown.thermal;
+  thermal.reset();
+
+  // The busy fraction of every group of cores, without grouping straight from
+  // the per core arrays. Dividing by at least one keeps the loop branchless,
+  // a core without any ticks is idle.
+  auto const &diff = shown.diff;
+  auto &usage = shown.usage;
+  if (_config.grouping == Grouping::none) {
+    usage.resize(diff.busy.size());
+    for (size_t i = 0; i < usage.size(); ++i)
+      usage[i] = (double)diff.busy[i] / std::max(diff.busy[i] + diff.notbusy[i], 1L);
+    shown.labels = diff.ids;
+  } else {
+    if (_topology.ids != diff.ids)
+      find_topology(diff.ids);
+    auto groups = _topology.labels.size();
+    _group_busy.assign(groups, 0);
+    _group_total.assign(groups, 0);
+    for (size_t i = 0; i < diff.busy.size(); ++i) {
+      _group_busy[_topology.group_of[i]] += diff.busy[i];
+      _group_total[_topology.group_of[i]] += diff.busy[i] + diff.notbusy[i];
+    }
+    usage.resize(groups);
+    for (size_t i = 0; i < groups; ++i)
+      usage[i] = (double)_group_busy[i] / std::max(_group_total[i], 1L);
+    shown.labels = _topology.labels;
+  }
+
+  shown.min_usage = usage.empty() ? 0 : std::ranges::min(usage);
+  shown.max_usage = usage.empty() ? 0 : std::ranges::max(usage);
+
+  // Averages neighbouring groups so that every cell is at least two pixels wide.
+  if (_config.view == View::heatmap) {
+    auto cells = std::min(usage.size(), std::max<size_t>(_config.heatmap_width / 2, 1));
+    shown.cells.assign(cells, 0);
+    for (size_t c = 0; c < cells; ++c) {
+      auto begin = c * usage.size() / cells, end = (c + 1) * usage.size() / cells;
+      for (auto i = begin; i < end; ++i)
+        shown.cells[c] += usage[i];
+      shown.cells[c] /= end - begin;
+    }
+  }
+
+  if (_config.thermal_zone_type) {
+    if (_thermal_zones_changed.exchange(false, std::memory_order_relaxed))
+      find_thermal_zone();
+
+    if (_thermal_zone) {
+      thermal.emplace();
+      thermal->temperature = _thermal_zone->temp.number().value_or(0);
+      auto const &points = _thermal_zone->trip_points;
+      auto temperature = thermal->temperature;
+      auto it = std::ranges::find_if(points, [&](auto const &point) { return point.temperature < temperature; });
       if (it != points.end())
-        _thermal->current_trip_point = *it;
-      else
-        _thermal->current_trip_point = std::nullopt;
+        thermal->current_trip_point = *it;
     }
   }
+
+  _shown.publish();
 }
 
 size_t CpuBlock::draw(ui::draw &draw, std::chrono::duration<double>) {
-  std::unique_lock lg(_update_mutex);
+  auto const &shown = _shown.read();
 
   size_t y = draw.vcenter();
   size_t x = 0;
-  auto percentage = 100.0 * _diff.total.busy() / _diff.total.total();
+  // Zero until the first update finishes.
+  auto percentage = shown.diff.total.total() == 0 ? 0 : 100.0 * shown.diff.total.busy() / shown.diff.total.total();
 
   x += draw.text(x, y, _config.prefix, _config.prefix_color);
   x += draw.text(x, y, fmt::format("{:>5.1f}%", percentage));
 
-  if (_thermal) {
+  if (shown.thermal) {
     x += draw.textw(" ");
 
     color color = 0xFFFFFF;
-    if (_thermal)
-      if (auto const &point = _thermal->current_trip_point)
+    if (shown.thermal)
+      if (auto const &point = shown.thermal->current_trip_point)
         color = point->color_by_type();
 
-    x += draw.text(x, y, fmt::format("{:.1f}°C", _thermal->temperature / 1000.), color);
+    x += draw.text(x, y, fmt::format("{:.1f}°C", shown.thermal->temperature / 1000.), color);
   }
 
   x += 5;
 
-  for (size_t i = 0; i < _diff.percore.size(); ++i) {
-    auto left = x;
-    auto width = 8;
-    auto top = 3;
-    auto bottom = draw.height() - 5;
-    auto height = bottom - top;
-    x += width;
+  auto const &usage = shown.usage;
+  auto top = 3;
+  auto bottom = draw.height() - 5;
+  auto height = bottom - top;
+
+  switch (_config.view) {
+  case View::bars:
+    _colors.resize(usage.size());
+    gradients::usage(usage, _colors);
+
+    for (size_t i = 0; i < usage.size(); ++i) {
+      auto left = x;
+      auto width = 8;
+      x += width;
 
-    auto maxfill = height - 1;
-    size_t fill = maxfill * (double)_diff.percore[i].busy() / _diff.percore[i].total();
+      auto maxfill = height - 1;
+      size_t fill = maxfill * usage[i];
 
-    auto hue = map_range(_diff.percore[i].busy(), 0, _diff.percore[i].total(), 120, 0);
-    color color = color::hsl(map_range(hue, 0, 360, 0, 1), 1, 0.5);
-    draw.frect(left, top + (maxfill - fill) + 1, width + 1, fill, color);
+      draw.frect(left, top + (maxfill - fill) + 1, width + 1, fill, _colors[i]);
 
-    draw.hrect(left, top, width, height);
+      draw.hrect(left, top, width, height);
+    }
+    break;
+
+  case View::heatmap: {
+    auto const &cells = shown.cells;
+    _colors.resize(cells.size());
+    gradients::usage(cells, _colors);
+
+    auto width = _config.heatmap_width;
+    for (size_t c = 0; c < cells.size(); ++c) {
+      auto left = c * width / cells.size(), right = (c + 1) * width / cells.size();
+      draw.frect(x + left, top + 1, right - left, height - 1, _colors[c]);
+    }
+    draw.hrect(x, top, width, height);
+    x += width;
+    break;
+  }
 
+  case View::summary: {
+    auto average = shown.diff.total.total() == 0 ? 0 : (double)shown.diff.total.busy() / shown.diff.total.total();
+    x += draw.text(x, y, fmt::format("{:>3.0f}", 100 * shown.min_usage), gradients::usage(shown.min_usage));
+    x += draw.text(x, y, "/");
+    x += draw.text(x, y, fmt::format("{:>3.0f}", 100 * average), gradients::usage(average));
+    x += draw.text(x, y, "/");
+    x += draw.text(x, y, fmt::format("{:>3.0f}%", 100 * shown.max_usage), gradients::usage(shown.max_usage));
+    break;
+  }
   }
 
   return x;
 }
 
 void CpuBlock::draw_tooltip(ui::draw &draw, std::chrono::duration<double>, unsigned width) const {
-  std::unique_lock lg(const_cast<std::mutex&>(_update_mutex));
+  auto const &shown = _shown.read();
 
   unsigned const bar_width = 100;
 
-  auto draw_one = [this, &draw, width](std::string_view title, Times const &times, unsigned yoff, bool all) {
+  auto draw_one = [&shown, &draw, width](std::string_view title, double usage, unsigned yoff, bool all) {
     draw.text(0, 12 + yoff, title);
 
-    size_t fill = times.total() == 0 ? 0 : bar_width * times.busy() / times.total();
-    auto hue = map_range(times.busy(), 0, times.total(), 120, 0);
-    color color = color::hsl(map_range(hue, 0, 360, 0, 1), 1, 0.5);
-    draw.frect(width - bar_width, 3 + yoff, fill, 16, color);
+    size_t fill = bar_width * usage;
+    draw.frect(width - bar_width, 3 + yoff, fill, 16, gradients::usage(usage));
     draw.hrect(width - bar_width, 3 + yoff, bar_width, 16);
 
-    auto percentage = times.total() == 0 ? 0 : 100.0 * times.busy() / times.total();
-    auto ptext = fmt::format("{:.1f}%", percentage);
+    auto ptext = fmt::format("{:.1f}%", 100 * usage);
     auto ptextw = draw.textw(ptext);
 
     auto x = width - bar_width - 4 - ptextw;
     draw.text(x, 12 + yoff, ptext);
 
-    if (all && _thermal) {
-      auto ttext = fmt::format("{:.1f}°C", _thermal->temperature / 1000.);
+    if (all && shown.thermal) {
+      auto ttext = fmt::format("{:.1f}°C", shown.thermal->temperature / 1000.);
       auto ttextw = draw.textw(ttext);
 
       draw.text(x - ttextw - 8, 12 + yoff, ttext);
 
-      if (auto const &point = _thermal->current_trip_point) {
+      if (auto const &point = shown.thermal->current_trip_point) {
         auto const &tptext = fmt::format("{} thermal point", point->type);
         auto tptextw = draw.textw(tptext);
         draw.text(width / 2 - tptextw / 2, 32 + yoff, tptext, point->color_by_type());
@@ -207,24 +302,44 @@ void CpuBlock::draw_tooltip(ui::draw &draw, std::chrono::duration<double>, unsig
     }
   };
 
-  draw_one("ALL", _diff.total, 0, true);
-
-  auto tpoff = (_thermal && _thermal->current_trip_point) * 10;
-
-  for (unsigned core = 0; core < _diff.percore.size(); ++core)
-    draw_one(fmt::format("CORE {}", core), _diff.percore[core], 10 + tpoff + 20 * (core + 1), false);
+  auto const &total = shown.diff.total;
+  draw_one("ALL", total.total() == 0 ? 0 : (double)total.busy() / total.total(), 0, true);
+
+  auto tpoff = (shown.thermal && shown.thermal->current_trip_point) * 10;
+
+  std::string_view group_name = "CORE";
+  if (_config.grouping == Grouping::socket)
+    group_name = "SOCKET";
+  else if (_config.grouping == Grouping::numa)
+    group_name = "NODE";
+  auto groups = shown.usage.size();
+  unsigned top = 30 + tpoff;
+  unsigned groups_height;
+  if (groups <= _config.tooltip_rows) {
+    for (unsigned group = 0; group < groups; ++group)
+      draw_one(fmt::format("{} {}", group_name, shown.labels[group]), shown.usage[group], top + 20 * group, false);
+    groups_height = 20 * groups;
+  } else {
+    // In the order of the bar's cells, row by row.
+    unsigned const cell = 10, step = cell + 2;
+    unsigned columns = std::max((width + 2) / step, 1u);
+    for (unsigned group = 0; group < groups; ++group)
+      draw.frect(step * (group % columns), top + 3 + step * (group / columns), cell, cell,
+                 gradients::usage(shown.usage[group]));
+    groups_height = step * ((groups + columns - 1) / columns);
+  }
 
-  auto yoff = 40 + tpoff + 20 * _diff.percore.size();
+  auto yoff = top + 10 + groups_height;
   {
-    draw.text(0, 12 + yoff, fmt::format("SYSTEM: {:.1f}%", 100.0 * _diff.total.system / _diff.total.total()));
-    auto rtext = fmt::format("IOWAIT: {:.1f}%", 100.0 * _diff.total.iowait / _diff.total.total());
+    draw.text(0, 12 + yoff, fmt::format("SYSTEM: {:.1f}%", 100.0 * shown.diff.total.system / shown.diff.total.total()));
+    auto rtext = fmt::format("IOWAIT: {:.1f}%", 100.0 * shown.diff.total.iowait / shown.diff.total.total());
     draw.text(width - draw.textw(rtext), 12 + yoff, rtext);
   }
 
   yoff += 20;
   {
-    draw.text(0, 12 + yoff, fmt::format("USER {:.1f}%", 100.0 * _diff.total.user / _diff.total.total()));
-    auto rtext = fmt::format("IDLE: {:.1f}%", 100.0 * _diff.total.idle / _diff.total.total());
+    draw.text(0, 12 + yoff, fmt::format("USER {:.1f}%", 100.0 * shown.diff.total.user / shown.diff.total.total()));
+    auto rtext = fmt::format("IDLE: {:.1f}%", 100.0 * shown.diff.total.idle / shown.diff.total.total());
     draw.text(width - draw.textw(rtext), 12 + yoff, rtext);
   }
 }
@@ -1,72 +1,62 @@
 #pragma once
 
-#include <cassert>
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
 
 #include "../block.hh"
+#include "../samplers.hh"
+#include "../snapshot.hh"
+#include "../sysfs_attr.hh"
+#include "../uevent_monitor.hh"
 
 class CpuBlock : public SimpleBlock {
-  struct Times {
-    long user;
-    long nice;
-    long system;
-
-    long idle;
-    long iowait;
-
-    long irq;
-    long softirq;
-
-    long steal;
-    long guest;
-    long guest_nice;
-
-    long busy() const { return user + nice + system + irq + softirq + steal + guest + guest_nice; }
-    long notbusy() const { return idle + iowait; }
-    long total() const { return busy() + notbusy(); }
-
-    Times operator-(const Times &other) const {
-      Times result;
-
-      result.user = user - other.user;
-      result.nice = nice - other.nice;
-      result.system = system - other.system;
-      result.idle = idle - other.idle;
-      result.iowait = iowait - other.iowait;
-      result.irq = irq - other.irq;
-      result.softirq = softirq - other.softirq;
-      result.steal = steal - other.steal;
-      result.guest = guest - other.guest;
-      result.guest_nice = guest_nice - other.guest_nice;
-
-      return result;
-    }
-  };
-
-  struct AllTimes {
-    Times total;
-    std::vector<Times> percore;
+  using Times = samplers::cpu_times::times;
+  using AllTimes = samplers::cpu_times;
 
-    AllTimes operator-(AllTimes &other) {
-      AllTimes result;
+  // The sample the next update compares against, shared with other blocks
+  // reading /proc/stat.
+  std::shared_ptr<samplers::sample<AllTimes> const> _previous;
 
-      result.total = total - other.total;
-      assert(percore.size() == other.percore.size());
-      for (size_t i = 0; i < percore.size(); ++i)
-        result.percore.push_back(percore[i] - other.percore[i]);
+  // Only used in draw, kept around to avoid reallocating it every frame.
+  std::vector<color> _colors;
 
-      return result;
-    }
+public:
+  // How the usage of the cores is shown next to the total.
+  enum class View {
+    // A bar per group of cores.
+    bars,
+    // A cell per group of cores in a strip of fixed width.
+    heatmap,
+    // The usage of the least and most busy group and the average.
+    summary,
+  };
+  // Which cores are shown together, from /sys/devices/system/cpu/cpu*/.
+  enum class Grouping {
+    none,
+    // Hyperthreads of the same core.
+    smt,
+    socket,
+    numa,
   };
 
-  AllTimes _previous;
-  AllTimes _current;
-
-  AllTimes _diff;
+private:
+  // Which group every core of the last sample belongs to, only touched by
+  // update(). Built again when cores go on- or offline.
+  struct Topology {
+    std::vector<std::uint32_t> ids;
+    std::vector<std::uint32_t> group_of;
+    // The number of every group, that of its first core without grouping.
+    std::vector<std::uint32_t> labels;
+  };
+  Topology _topology;
+  // Per group sums, scratch space for update().
+  std::vector<long> _group_busy, _group_total;
 
-  AllTimes read_cpu_times();
+  void find_topology(std::vector<std::uint32_t> const &ids);
 
   struct ThermalInfo {
     struct TripPoint {
@@ -96,15 +86,46 @@ class CpuBlock : public SimpleBlock {
     long temperature;
   };
 
-  std::optional<ThermalInfo> _thermal;
-
-  std::mutex _update_mutex;
+  // The configured thermal zone, found at startup and again whenever a thermal
+  // zone comes or goes. Trip points don't change, only the temperature is read
+  // on every update.
+  struct ThermalZone {
+    sysfs_attr temp;
+    // By ascending temperature, one per temperature.
+    std::vector<ThermalInfo::TripPoint> trip_points;
+  };
+  std::optional<ThermalZone> _thermal_zone;
+  // Set from the loop thread, updates may run on a worker.
+  std::atomic<bool> _thermal_zones_changed{true};
+  uevent_monitor _thermal_uevents;
+
+  void find_thermal_zone();
+
+  // What update() hands over to draw().
+  struct Shown {
+    AllTimes diff;
+    // The busy fraction of every group of cores, and their numbers.
+    std::vector<double> usage;
+    std::vector<std::uint32_t> labels;
+    // Groups averaged so that there are at most heatmap_width / 2 of them.
+    std::vector<double> cells;
+    double min_usage = 0, max_usage = 0;
+    std::optional<ThermalInfo> thermal;
+  };
+  snapshot<Shown> _shown;
 
 public:
   struct Config {
     std::string prefix;
     color prefix_color = 0xFFFFFF;
     std::optional<std::string> thermal_zone_type;
+    View view = View::bars;
+    Grouping grouping = Grouping::none;
+    // The heatmap is this wide however many cores there are.
+    size_t heatmap_width = 64;
+    // The tooltip shows a row per group up to this many groups, more are shown
+    // as a grid of usage colored cells.
+    size_t tooltip_rows = 16;
   };
 
 private:
@@ -117,6 +138,9 @@ public:
   size_t draw(ui::draw &, std::chrono::duration<double> delta) override;
   void update() override;
   Interval update_interval() override { return std::chrono::milliseconds(500); }
+  // Reading the temperature of a thermal zone can evaluate slow ACPI methods.
+  bool update_may_block() override { return _config.thermal_zone_type.has_value(); }
+  bool update_may_move() override { return true; }
 
   bool has_tooltip() const override { return true; }
   void draw_tooltip(ui::draw &, std::chrono::duration<double>, unsigned) const override;
@@ -7,6 +7,7 @@
 #include <sys/types.h>
 #include <system_error>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <fmt/core.h>
@@ -50,9 +51,26 @@ std::unordered_map<__fsword_t, std::string> fs_type_to_name_map = {
 DiskBlock::DiskBlock(const std::filesystem::path &path, Config config) : _mountpoint(path), _config(config) {}
 DiskBlock::~DiskBlock() {}
 
+// Runs on a worker thread, statfs on a network filesystem can hang for as long
+// as the server is unreachable.
 void DiskBlock::update() {
-  if (statfs(_mountpoint.c_str(), &_statfs) < 0)
+  struct statfs result;
+  if (statfs(_mountpoint.c_str(), &result) < 0)
     throw std::system_error(errno, std::generic_category(), fmt::format("statfs({:?})", _mountpoint.string()));
+
+  _statfs.publish(result);
+
+  auto used = (result.f_blocks - result.f_bfree) * result.f_bsize;
+  auto total = result.f_blocks * result.f_bsize;
+  Visible visible{
+      .type = result.f_type,
+      .used = to_sensible_unit(used, 1),
+      .total = to_sensible_unit(total, 1),
+      .used_permille = total ? unsigned(1000 * used / total) : 0,
+  };
+  _changed = visible != _visible;
+  if (_changed)
+    _visible = std::move(visible);
 }
 
 size_t DiskBlock::draw(ui::draw &draw, std::chrono::duration<double>) {
@@ -62,9 +80,17 @@ size_t DiskBlock::draw(ui::draw &draw, std::chrono::duration<double>) {
   if (!title.empty())
     x += draw.text(x, title);
 
+  auto const &shown = _statfs.read();
+  if (!shown) {
+    // The first update hasn't finished yet.
+    x += 5 * !title.empty();
+    return x + draw.text(x, "...", 0x888888);
+  }
+  auto const &fs = *shown;
+
   if (_config.show_fs_type) {
     x += 5 * !title.empty();
-    auto it = fs_type_to_name_map.find(_statfs.f_type);
+    auto it = fs_type_to_name_map.find(fs.f_type);
     if (it != fs_type_to_name_map.end()) {
       x += draw.text(x, it->second);
     } else {
@@ -72,8 +98,8 @@ size_t DiskBlock::draw(ui::draw &draw, std::chrono::duration<double>) {
     }
   }
 
-  auto used = (_statfs.f_blocks - _statfs.f_bfree) * _statfs.f_bsize;
-  auto total = _statfs.f_blocks * _statfs.f_bsize;
+  auto used = (fs.f_blocks - fs.f_bfree) * fs.f_bsize;
+  auto total = fs.f_blocks * fs.f_bsize;
 
   if (_config.show_usage_text && !_config.usage_text_in_bar) {
     x += 5 * (_config.show_fs_type || !title.empty());
@@ -102,9 +128,7 @@ size_t DiskBlock::draw(ui::draw &draw, std::chrono::duration<double>) {
 
     color color;
     if (!_config.bar_fill_color) {
-      // Explained in battery.cc
-      auto hue = map_range(map_range(used, 0, total, 100, 0), 0, 360, 0, 1);
-      color = color::hsl(hue, .9, .45);
+      color = gradients::level(1 - (double)used / total);
     } else
       color = *_config.bar_fill_color;
 
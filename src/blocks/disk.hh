@@ -4,6 +4,7 @@
 #include <cstddef>
 #include <filesystem>
 #include <optional>
+#include <string>
 #include <sys/types.h>
 #include <unordered_map>
 #include <vector>
@@ -11,9 +12,23 @@
 #include <sys/vfs.h>
 
 #include "../block.hh"
+#include "../snapshot.hh"
 
 class DiskBlock : public SimpleBlock {
-  struct statfs _statfs;
+  // Published from a worker thread, see update_may_block().
+  snapshot<std::optional<struct statfs>> _statfs;
+
+  // Everything about the filesystem that ends up on screen, used to tell whether
+  // an update changed anything.
+  struct Visible {
+    __fsword_t type;
+    std::string used, total;
+    unsigned used_permille;
+
+    bool operator==(Visible const &) const = default;
+  };
+  Visible _visible;
+  bool _changed = true;
 
   std::filesystem::path _mountpoint;
 
@@ -26,6 +41,8 @@ public:
     bool show_usage_bar;
     ui::draw::pos_t bar_width;
     std::optional<color> bar_fill_color{};
+    // The update interval is stretched up to this while the usage doesn't change.
+    Interval max_update_interval = std::chrono::seconds(60);
   };
 
 private:
@@ -40,4 +57,7 @@ public:
   Interval update_interval() override {
     return std::chrono::seconds(3);
   }
+  Interval max_update_interval() override { return _config.max_update_interval; }
+  bool needs_redraw() override { return _changed; }
+  bool update_may_block() override { return true; }
 };
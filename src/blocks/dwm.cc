@@ -40,7 +40,7 @@ void DwmBlock::late_init() {
   {
     auto tags = _connection.get_tags();
     for (const auto &tag : *tags) {
-      _tags.push_back(Tag{
+      _state.tags.push_back(Tag{
           // HACK: You might ask, why's this shit here?
           //       and I can only tell you, I don't fucking know.
           .name = tag.tag_name == "" ? "1" : tag.tag_name,
@@ -53,7 +53,7 @@ void DwmBlock::late_init() {
   }
 
   auto update_tag_states = [&](const dwmipc::TagState &state) {
-    for (auto &tag : _tags) {
+    for (auto &tag : _state.tags) {
       tag.selected = state.selected & tag.bitmask;
       tag.occupied = state.occupied & tag.bitmask;
       tag.urgent = state.urgent & tag.bitmask;
@@ -63,69 +63,77 @@ void DwmBlock::late_init() {
   for (const auto &mon : *monitors) {
     if (mon.is_selected) {
       if (mon.clients.selected == 0) {
-        _focused_client_title = "";
-        _focused_client_floating = false;
-        _focused_client_urgent = false;
+        _state.focused_client_title = "";
+        _state.focused_client_floating = false;
+        _state.focused_client_urgent = false;
       } else {
         auto c = _connection.get_client(mon.clients.selected);
-        _focused_client_title = c->name;
-        _focused_client_floating = c->states.is_floating;
-        _focused_client_urgent = c->states.is_urgent;
-        _layout_symbol = mon.layout.symbol.cur;
+        _state.focused_client_title = c->name;
+        _state.focused_client_floating = c->states.is_floating;
+        _state.focused_client_urgent = c->states.is_urgent;
+        _state.layout_symbol = mon.layout.symbol.cur;
       }
     }
   }
 
-  _connection.on_tag_change = [update_tag_states](const dwmipc::TagChangeEvent &event) {
+  publish();
+
+  _connection.on_tag_change = [this, update_tag_states](const dwmipc::TagChangeEvent &event) {
     update_tag_states(event.new_state);
-    bar::instance().schedule_redraw();
+    publish();
   };
   _connection.subscribe(dwmipc::Event::TAG_CHANGE);
   _connection.on_client_focus_change = [this](const dwmipc::ClientFocusChangeEvent &event) {
     if (event.new_win_id == 0) {
-      _focused_client_title = "";
-      _focused_client_floating = false;
-      _focused_client_urgent = false;
+      _state.focused_client_title = "";
+      _state.focused_client_floating = false;
+      _state.focused_client_urgent = false;
     } else {
       try {
         auto c = _connection.get_client(event.new_win_id);
 
-        _focused_client_title = c->name;
-        _focused_client_floating = c->states.is_floating;
-        _focused_client_urgent = c->states.is_urgent;
+        _state.focused_client_title = c->name;
+        _state.focused_client_floating = c->states.is_floating;
+        _state.focused_client_urgent = c->states.is_urgent;
       } catch (dwmipc::ResultFailureError &err) {
         fmt::print(warn, "get_client(ClientFocusChangeEvent->client) failed: {}\n", err.what());
 
-        _focused_client_title = "";
-        _focused_client_floating = false;
-        _focused_client_urgent = false;
+        _state.focused_client_title = "";
+        _state.focused_client_floating = false;
+        _state.focused_client_urgent = false;
       }
     }
-    bar::instance().schedule_redraw();
+    publish();
   };
   _connection.subscribe(dwmipc::Event::CLIENT_FOCUS_CHANGE);
   _connection.on_focused_title_change = [this](const dwmipc::FocusedTitleChangeEvent &event) {
-    _focused_client_title = event.new_name;
-    bar::instance().schedule_redraw();
+    _state.focused_client_title = event.new_name;
+    publish();
   };
   _connection.subscribe(dwmipc::Event::FOCUSED_TITLE_CHANGE);
   _connection.on_layout_change = [this](const dwmipc::LayoutChangeEvent &event) {
-    _layout_symbol = event.new_symbol;
-    bar::instance().schedule_redraw();
+    _state.layout_symbol = event.new_symbol;
+    publish();
   };
   _connection.subscribe(dwmipc::Event::LAYOUT_CHANGE);
   _connection.on_focused_state_change = [this](const dwmipc::FocusedStateChangeEvent &event) {
-    _focused_client_floating = event.new_state.is_floating;
-    _focused_client_urgent = event.new_state.is_urgent;
-    bar::instance().schedule_redraw();
+    _state.focused_client_floating = event.new_state.is_floating;
+    _state.focused_client_urgent = event.new_state.is_urgent;
+    publish();
   };
   _connection.subscribe(dwmipc::Event::FOCUSED_STATE_CHANGE);
 }
 DwmBlock::~DwmBlock() {}
 
+void DwmBlock::publish() {
+  _shown.publish(_state);
+  bar::instance().schedule_redraw();
+}
+
 size_t DwmBlock::draw(ui::draw &draw, std::chrono::duration<double>) {
+  auto const &state = _shown.read();
   size_t x = 0;
-  for (const auto &tag : _tags) {
+  for (const auto &tag : state.tags) {
     if (!(tag.occupied && !_config.show_empty_tags) && !tag.selected && !tag.urgent)
       continue;
     color color;
@@ -141,10 +149,10 @@ size_t DwmBlock::draw(ui::draw &draw, std::chrono::duration<double>) {
     x += 7;
   }
 
-  x += draw.text(x, draw.vcenter(), _layout_symbol) + 7;
+  x += draw.text(x, draw.vcenter(), state.layout_symbol) + 7;
 
-  std::string title =
-      _focused_client_floating ? (_config.floating_title_prefix + _focused_client_title) : _focused_client_title;
+  std::string title = state.focused_client_floating ? (_config.floating_title_prefix + state.focused_client_title)
+                                                    : state.focused_client_title;
   ui::draw::pos_t width = 0;
   if (_config.max_title_length) {
     auto end = std::min(title.begin() + *_config.max_title_length, title.end());
@@ -155,7 +163,7 @@ size_t DwmBlock::draw(ui::draw &draw, std::chrono::duration<double>) {
     width = draw.textw(xs);
   }
   x += std::max(width, draw.text(x, draw.vcenter(), title,
-                                 _focused_client_floating ? _config.floating_title_color : _config.title_color));
+                                 state.focused_client_floating ? _config.floating_title_color : _config.title_color));
   return x;
 }
 void DwmBlock::update() { _connection.handle_event(); }
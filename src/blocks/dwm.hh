@@ -12,6 +12,7 @@
 #include <vector>
 
 #include "../block.hh"
+#include "../snapshot.hh"
 #include "dwmipcpp/connection.hpp"
 
 class DwmBlock : public SimpleBlock {
@@ -23,12 +24,19 @@ class DwmBlock : public SimpleBlock {
     bool occupied;
     bool urgent;
   };
-  std::vector<Tag> _tags;
-  std::string _focused_client_title;
-  bool _focused_client_floating{false};
-  // TODO: Make a better system for customising title based on state.
-  bool _focused_client_urgent{false};
-  std::string _layout_symbol;
+  struct State {
+    std::vector<Tag> tags;
+    std::string focused_client_title;
+    bool focused_client_floating{false};
+    // TODO: Make a better system for customising title based on state.
+    bool focused_client_urgent{false};
+    std::string layout_symbol;
+  };
+  // Modified by dwm's events on the loop thread and then published to draw().
+  State _state;
+  snapshot<State> _shown;
+
+  void publish();
 
 public:
   struct Config {
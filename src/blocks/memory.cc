@@ -1,7 +1,4 @@
 #include <cstddef>
-#include <filesystem>
-#include <fstream>
-#include <iostream>
 #include <string>
 
 #include <fmt/core.h>
@@ -9,34 +6,23 @@
 
 #include "memory.hh"
 #include "../log.hh"
+#include "../samplers.hh"
 #include "../util.hh"
 
 MemoryBlock::MemoryBlock(const Config &config) : _config(config) {}
 
 void MemoryBlock::update() {
-  auto file = std::ifstream("/proc/meminfo");
-  if (!file.is_open()) {
-    fmt::print(error,
-               "Could not open /proc/meminfo; MemoryBlock update skipped!\n");
-    return;
-  }
-
-  std::string line;
-  while (std::getline(file, line)) {
-    if (line.find("MemTotal:") != std::string::npos) {
-      _total = std::stoul(line.substr(line.find_last_of(':') + 1));
-    } else if (line.find("MemAvailable:") != std::string::npos) {
-      _avail = std::stoul(line.substr(line.find_last_of(':') + 1));
-    }
-  }
-  _used = _total - _avail;
+  auto sample = samplers::proc_meminfo().get();
+  auto const &info = sample->value;
+  _usage.publish({.total = info.total, .used = info.total - info.available});
 }
 
 size_t MemoryBlock::draw(ui::draw &draw, std::chrono::duration<double>) {
+  auto const &usage = _usage.read();
   size_t x = draw.text(0, _config.prefix, _config.prefix_color);
 
-  std::string text = fmt::format("{}/{}", to_sensible_unit(_used * 1024),
-                                 to_sensible_unit(_total * 1024));
+  std::string text = fmt::format("{}/{}", to_sensible_unit(usage.used * 1024),
+                                 to_sensible_unit(usage.total * 1024));
 
   auto top = 3;
   auto bottom = draw.height() - 5;
@@ -45,7 +31,7 @@ size_t MemoryBlock::draw(ui::draw &draw, std::chrono::duration<double>) {
   auto height = bottom - top;
   x += width;
 
-  auto percent = (double)_used / _total;
+  auto percent = (double)usage.used / usage.total;
   auto fillwidth = (width - 1) * percent;
   color color;
   if (percent > 0.85) {
@@ -2,15 +2,18 @@
 
 #include <chrono>
 #include <cstddef>
-#include <fstream>
 #include <string>
 
 #include "../block.hh"
+#include "../snapshot.hh"
 
 class MemoryBlock : public SimpleBlock {
-  size_t _total;
-  size_t _used;
-  size_t _avail;
+  // In KiB, like /proc/meminfo.
+  struct Usage {
+    size_t total;
+    size_t used;
+  };
+  snapshot<Usage> _usage;
 
 public:
   struct Config {
@@ -29,4 +32,5 @@ public:
   Interval update_interval() override {
     return std::chrono::milliseconds(500);
   }
+  bool update_may_move() override { return true; }
 };
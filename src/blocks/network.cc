@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <atomic>
 #include <charconv>
 #include <concepts>
@@ -9,14 +10,10 @@
 #include <ios>
 #include <iostream>
 #include <limits>
-#include <mutex>
 #include <optional>
-#include <spawn.h>
 #include <stdexcept>
 #include <string>
 #include <string_view>
-#include <sys/mman.h>
-#include <sys/wait.h>
 #include <system_error>
 #include <unistd.h>
 #include <unordered_map>
@@ -24,6 +21,7 @@
 
 #include <fmt/core.h>
 
+#include "../co.hh"
 #include "../log.hh"
 #include "../util.hh"
 #include "network.hh"
@@ -105,34 +103,24 @@ void iwctl_parse_output(std::string const &output, IwctlStationInfo &info) {
   }
 }
 
-void iwctl_update_station(WifiStation &station) {
-  run(&station.iwctl_process, {"iwctl", "station", station.name, "show"}, {NULL},
-      [&station](int status, int signal, std::string output) {
-        if (status || signal) {
-          if (signal)
-            station.iwctl_status = -1;
-          else
-            station.iwctl_status = status;
-          station.info.reset();
-        }
-
-        IwctlStationInfo new_info;
-        try {
-          iwctl_parse_output(output, new_info);
-        } catch (std::exception const &ex) {
-          warn << "failed to parse iwd output for " << station.name << ": " << ex.what() << '\n';
-          station.update_running.clear(std::memory_order_release);
-          return;
-        }
-
-        {
-          std::unique_lock lock(station.modify_mutex);
-          station.iwctl_status = 0;
-          station.info = std::move(new_info);
-        }
-
-        station.update_running.clear(std::memory_order_release);
-      });
+co::task<> iwctl_update_station(WifiStation &station) {
+  std::vector<std::string> argv{"iwctl", "station", station.name, "show"};
+  // iwctl gets an empty environment.
+  std::vector<char *> env{nullptr};
+  auto process = co_await co::run(std::move(argv), std::move(env));
+  station.update_running = false;
+
+  IwctlStationInfo new_info;
+  try {
+    iwctl_parse_output(process.output, new_info);
+  } catch (std::exception const &ex) {
+    warn << "failed to parse iwd output for " << station.name << ": " << ex.what() << '\n';
+    if (process.status || process.signal)
+      station.state.publish({.iwctl_status = process.signal ? -1 : (int)process.status, .info = std::nullopt});
+    co_return;
+  }
+
+  station.state.publish({.iwctl_status = 0, .info = std::move(new_info)});
 }
 
 NetworkBlock::Config NetworkBlock::Config::autodetect() {
@@ -154,67 +142,71 @@ NetworkBlock::Config NetworkBlock::Config::autodetect() {
   return out;
 }
 
-void NetworkBlock::update() {
-  _tx_bytes = 0, _rx_bytes = 0;
+void NetworkBlock::find_devices() {
+  _devices.clear();
   for (auto &n : std::filesystem::directory_iterator("/sys/class/net/")) {
-    if (!std::filesystem::exists(n.path() / "device"))
-      continue;
-    auto tx = n.path() / "statistics" / "tx_bytes";
-    auto rx = n.path() / "statistics" / "rx_bytes";
-    auto read = [](std::filesystem::path p) {
-      std::ifstream ifs(p);
-      if (!ifs.is_open())
-        return 0ul;
-      size_t a;
-      ifs >> a >> a;
-      return a;
-    };
-    if (std::filesystem::exists(tx))
-      _tx_bytes += read(tx);
-    if (std::filesystem::exists(rx))
-      _rx_bytes += read(rx);
+    if (std::filesystem::exists(n.path() / "device"))
+      _devices.push_back(n.path().filename().string());
   }
-  auto old_tx = _tx_bytes, old_rx = _rx_bytes;
-
-  _tx_bytes -= _last_tx_bytes;
-  _rx_bytes -= _last_rx_bytes;
+}
 
-  _last_tx_bytes = old_tx;
-  _last_rx_bytes = old_rx;
+void NetworkBlock::update() {
+  auto now = std::chrono::steady_clock::now();
+  if (now >= _next_rescan) {
+    find_devices();
+    _next_rescan = now + rescan_interval;
+  }
 
-  for (auto const &name : _config._ethernet_devices) {
-    std::ifstream(std::filesystem::path("/sys/class/net/") / name / "carrier") >> _ethernet_connected;
-    if (_ethernet_connected)
-      break;
+  // The counters of all interfaces come from a single shared read of /proc/net/dev.
+  auto counters = samplers::proc_net_dev().get();
+  size_t tx_bytes = 0, rx_bytes = 0;
+  for (auto const &interface : counters->value.interfaces) {
+    if (std::ranges::find(_devices, interface.name) == _devices.end())
+      continue;
+    tx_bytes += interface.tx_bytes;
+    rx_bytes += interface.rx_bytes;
   }
 
+  // Reading the carrier of an interface that is down fails.
+  bool ethernet_connected = std::ranges::any_of(
+      _ethernet_carriers, [](sysfs_attr &carrier) { return carrier.number().value_or(0) == 1; });
+
+  _traffic.publish({
+      .tx_bytes = tx_bytes - _last_tx_bytes,
+      .rx_bytes = rx_bytes - _last_rx_bytes,
+      .ethernet_connected = ethernet_connected,
+  });
+  _last_tx_bytes = tx_bytes;
+  _last_rx_bytes = rx_bytes;
+
   for (auto &station : _wifi_stations) {
-    if (!station.update_running.test_and_set(std::memory_order_acq_rel))
-      iwctl_update_station(station);
+    if (!std::exchange(station.update_running, true))
+      co::spawn(iwctl_update_station(station));
   }
 }
 
 size_t NetworkBlock::draw(ui::draw &draw, std::chrono::duration<double>) {
+  auto const &traffic = _traffic.read();
   auto x = 0;
 
-  if (_ethernet_connected)
+  if (traffic.ethernet_connected)
     x += draw.text(x, "");
 
   for (auto const &station : _wifi_stations) {
-    std::unique_lock lock(station.modify_mutex);
-    if (station.info) {
-      if ((station.info->connection || station.info->scanning) && (x != 0 || _ethernet_connected))
+    auto const &state = station.state.read();
+    if (state.info) {
+      if ((state.info->connection || state.info->scanning) && (x != 0 || traffic.ethernet_connected))
         x += 10;
-      if (station.info->connection)
+      if (state.info->connection)
         x += draw.text(x, " ");
-      if (station.info->scanning) {
+      if (state.info->scanning) {
         x += draw.text(x, "󰍉");
-        if (!station.info->connection)
+        if (!state.info->connection)
           x += draw.text(x, station.name);
       }
-      if (station.info->connection)
-        x += draw.text(x, station.info->connection->connected_network);
-    } else if (station.iwctl_status) {
+      if (state.info->connection)
+        x += draw.text(x, state.info->connection->connected_network);
+    } else if (state.iwctl_status) {
       x += draw.text(x, fmt::format(" {} unknown", station.name), color(0xFF0000));
     }
   }
@@ -231,9 +223,9 @@ void NetworkBlock::draw_tooltip(ui::draw &draw, std::chrono::duration<double>, u
 
   auto y = 0;
   for (auto const &station : _wifi_stations) {
-    std::unique_lock lock(station.modify_mutex);
+    auto const &state = station.state.read();
 
-    if (!station.iwctl_status && !station.info->scanning && !station.info->connection)
+    if (!state.iwctl_status && (!state.info || (!state.info->scanning && !state.info->connection)))
       continue;
 
     auto const &t = station.name;
@@ -241,8 +233,8 @@ void NetworkBlock::draw_tooltip(ui::draw &draw, std::chrono::duration<double>, u
 
     y += 20;
 
-    if (station.iwctl_status) {
-      auto t = fmt::format("'iwctl station {} show' exited with {}", station.name, station.iwctl_status);
+    if (state.iwctl_status) {
+      auto t = fmt::format("'iwctl station {} show' exited with {}", station.name, state.iwctl_status);
       auto w = draw.textw(t);
       ui::draw::pos_t tx = 0;
       if (width < w)
@@ -253,14 +245,14 @@ void NetworkBlock::draw_tooltip(ui::draw &draw, std::chrono::duration<double>, u
       y += 20;
     } else {
 
-      if (station.info->scanning) {
+      if (state.info->scanning) {
         auto t = "Scanning...";
         draw.text((width - draw.textw(t)) / 2, 12 + y, t, 0x8888FF);
         y += 20;
       }
 
-      if (station.info->connection) {
-        auto const &conn = station.info->connection;
+      if (state.info->connection) {
+        auto const &conn = state.info->connection;
 
         unsigned x = 0;
         x += draw.text(x, 12 + y, "Connected to ");
@@ -289,7 +281,8 @@ void NetworkBlock::draw_tooltip(ui::draw &draw, std::chrono::duration<double>, u
   if (y)
     y += 10;
 
-  draw.text(0, 12 + y, fmt::format("Rx {: >8}/s", to_sensible_unit(_rx_bytes, 1)));
-  auto t = fmt::format("Tx {: >8}/s", to_sensible_unit(_tx_bytes, 1));
+  auto const &traffic = _traffic.read();
+  draw.text(0, 12 + y, fmt::format("Rx {: >8}/s", to_sensible_unit(traffic.rx_bytes, 1)));
+  auto t = fmt::format("Tx {: >8}/s", to_sensible_unit(traffic.tx_bytes, 1));
   draw.text((width - draw.textw(t)), 12 + y, t);
 }
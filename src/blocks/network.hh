@@ -6,7 +6,6 @@
 #include <cstdlib>
 #include <filesystem>
 #include <forward_list>
-#include <mutex>
 #include <ranges>
 #include <string>
 #include <unordered_map>
@@ -15,7 +14,10 @@
 #include <fmt/core.h>
 
 #include "../block.hh"
-#include "../run.hh"
+#include "../co.hh"
+#include "../samplers.hh"
+#include "../snapshot.hh"
+#include "../sysfs_attr.hh"
 
 struct IwctlConnectionInfo {
   std::string connected_network;
@@ -37,21 +39,34 @@ struct IwctlStationInfo {
 
 struct WifiStation {
   std::string name;
-  mutable std::mutex modify_mutex;
-  std::atomic_flag update_running;
-  int iwctl_status;
-  nuv_process iwctl_process;
-  std::optional<IwctlStationInfo> info;
+  // Only touched by the loop thread.
+  bool update_running = false;
+
+  struct State {
+    int iwctl_status = 0;
+    std::optional<IwctlStationInfo> info;
+  };
+  // Published when iwctl finishes on the loop thread.
+  snapshot<State> state;
 
   WifiStation(std::string const &name) : name(name) {}
 };
 
 // iwctl only for now
 class NetworkBlock : public SimpleBlock {
+  // The names of the interfaces backed by a device, whose traffic is counted.
+  // Looked for again every rescan_interval so that hotplugged ones are picked up.
+  static constexpr auto rescan_interval = std::chrono::seconds(10);
+  std::vector<std::string> _devices;
+  std::chrono::steady_clock::time_point _next_rescan{};
   size_t _last_tx_bytes = 0, _last_rx_bytes = 0;
-  size_t _tx_bytes, _rx_bytes;
 
-  bool _ethernet_connected = 0;
+  struct Traffic {
+    // Since the previous update.
+    size_t tx_bytes, rx_bytes;
+    bool ethernet_connected;
+  };
+  snapshot<Traffic> _traffic;
   std::forward_list<WifiStation> _wifi_stations;
 
   struct Config {
@@ -63,12 +78,17 @@ class NetworkBlock : public SimpleBlock {
 
 private:
   Config _config;
+  std::vector<sysfs_attr> _ethernet_carriers;
+
+  void find_devices();
 
 public:
   NetworkBlock() : NetworkBlock(Config::autodetect()) {}
   NetworkBlock(Config config) : _config(std::move(config)) {
     for (auto const &name : _config._wifi_devices)
       _wifi_stations.emplace_front(name);
+    for (auto const &name : _config._ethernet_devices)
+      _ethernet_carriers.emplace_back(std::filesystem::path("/sys/class/net/") / name / "carrier");
   }
   ~NetworkBlock() {}
 
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <typeinfo>
+#include <utility>
+
+#include <fmt/core.h>
+
+#include "../bar.hh"
+#include "../util.hh"
+#include "perf.hh"
+
+PerfBlock::PerfBlock(Config config) : _config(std::move(config)) {}
+
+void PerfBlock::update() {
+  auto &stats = perf::global();
+  auto &shown = _shown.back();
+
+  Sample current{
+      .time = perf::clock::now(),
+      .frames = stats.frames.count.load(std::memory_order_relaxed),
+      .frame_ns = stats.frames.total_ns.load(std::memory_order_relaxed),
+      .update_wakeups = stats.update_wakeups.load(std::memory_order_relaxed),
+      .ui_wakeups = stats.ui_wakeups.load(std::memory_order_relaxed),
+      .render_wakeups = stats.render_wakeups.load(std::memory_order_relaxed),
+      .ui_cpu = perf::thread_cpu_time(stats.ui_thread_clock.load(std::memory_order_relaxed)),
+      .render_cpu = perf::thread_cpu_time(stats.render_thread_clock.load(std::memory_order_relaxed)),
+      .loop_cpu = perf::thread_cpu_time(stats.loop_thread_clock.load(std::memory_order_relaxed)),
+  };
+
+  if (_last.time != perf::clock::time_point()) {
+    double elapsed = std::chrono::duration<double>(current.time - _last.time).count();
+    auto frames = current.frames - _last.frames;
+
+    shown.fps = frames / elapsed;
+    shown.frame_ms = frames ? (current.frame_ns - _last.frame_ns) / 1e6 / frames : 0;
+    shown.ui_cpu_percent = 100 * std::chrono::duration<double>(current.ui_cpu - _last.ui_cpu).count() / elapsed;
+    shown.render_cpu_percent =
+        100 * std::chrono::duration<double>(current.render_cpu - _last.render_cpu).count() / elapsed;
+    shown.loop_cpu_percent = 100 * std::chrono::duration<double>(current.loop_cpu - _last.loop_cpu).count() / elapsed;
+    shown.update_wakeups_per_minute = 60 * (current.update_wakeups - _last.update_wakeups) / elapsed;
+    shown.ui_wakeups_per_minute = 60 * (current.ui_wakeups - _last.ui_wakeups) / elapsed;
+    shown.render_wakeups_per_minute = 60 * (current.render_wakeups - _last.render_wakeups) / elapsed;
+  }
+  shown.max_frame_ms = stats.frames.max_ns.exchange(0, std::memory_order_relaxed) / 1e6;
+  shown.rss = perf::resident_set_size();
+
+  _last = current;
+  _shown.publish();
+}
+
+size_t PerfBlock::draw(ui::draw &draw, std::chrono::duration<double>) {
+  auto const &shown = _shown.read();
+  size_t x = 0;
+  x += draw.text(x, _config.prefix, _config.prefix_color);
+  auto cpu_percent = shown.ui_cpu_percent + shown.render_cpu_percent + shown.loop_cpu_percent;
+  x += draw.text(x, fmt::format("{:.1f}ms {:.0f}fps {:.1f}% {}", shown.frame_ms, shown.fps, cpu_percent,
+                                to_sensible_unit(shown.rss, 1)));
+  return x;
+}
+
+void PerfBlock::draw_tooltip(ui::draw &draw, std::chrono::duration<double>, unsigned) const {
+  auto &stats = perf::global();
+  auto const &shown = _shown.read();
+
+  // The tooltip is sized to what we draw, so line the values up after the widest label.
+  ui::draw::pos_t column = draw.textw("Render thread CPU");
+  bar::instance().for_each_block(
+      [&](Block const &block) { column = std::max(column, draw.textw(demangled_name(typeid(block)))); });
+  column += 16;
+
+  unsigned y = 0;
+  auto row = [&](std::string_view left, std::string_view right, color c = 0xFFFFFF) {
+    draw.text(0, 12 + y, left, c);
+    draw.text(column, 12 + y, right, c);
+    y += 20;
+  };
+
+  auto average_ms = [](perf::timing const &t) {
+    auto count = t.count.load(std::memory_order_relaxed);
+    return count ? t.total_ns.load(std::memory_order_relaxed) / 1e6 / count : 0.0;
+  };
+  auto max_ms = [](perf::timing const &t) { return t.max_ns.load(std::memory_order_relaxed) / 1e6; };
+
+  row("Frame time", fmt::format("{:.2f}ms (max {:.2f}ms)", shown.frame_ms, shown.max_frame_ms));
+  row("Frame rate", fmt::format("{:.1f}fps", shown.fps));
+  row("Input latency",
+      fmt::format("{:.2f}ms (max {:.2f}ms)", average_ms(stats.input_latency), max_ms(stats.input_latency)));
+  row("Event handling",
+      fmt::format("{:.3f}ms (max {:.3f}ms)", average_ms(stats.events), max_ms(stats.events)));
+  row("Loop lag", fmt::format("{:.2f}ms (max {:.2f}ms)", average_ms(stats.loop_lag), max_ms(stats.loop_lag)));
+  row("First frame", fmt::format("{:.1f}ms after start", stats.first_frame_ns.load(std::memory_order_relaxed) / 1e6));
+  row("UI thread CPU", fmt::format("{:.2f}%", shown.ui_cpu_percent));
+  row("Render thread CPU", fmt::format("{:.2f}%", shown.render_cpu_percent));
+  row("Loop thread CPU", fmt::format("{:.2f}%", shown.loop_cpu_percent));
+  row("Update wakeups", fmt::format("{:.0f}/min", shown.update_wakeups_per_minute));
+  row("UI wakeups", fmt::format("{:.0f}/min", shown.ui_wakeups_per_minute));
+  row("Render wakeups", fmt::format("{:.0f}/min", shown.render_wakeups_per_minute));
+  row("Resident memory", to_sensible_unit(shown.rss, 1));
+
+  auto hits = stats.text_cache_hits.load(std::memory_order_relaxed);
+  auto misses = stats.text_cache_misses.load(std::memory_order_relaxed);
+  row("Text cache", fmt::format("{} hits, {} misses ({:.1f}%)", hits, misses,
+                                hits + misses ? 100.0 * hits / (hits + misses) : 0.0));
+
+  y += 10;
+  row("Block", "draw avg/max, update avg/max", 0xAAAAAA);
+
+  bar::instance().for_each_block([&](Block const &block) {
+    auto &bs = block.perf_stats();
+    row(demangled_name(typeid(block)), fmt::format("{:.3f}/{:.3f}ms, {:.3f}/{:.3f}ms", average_ms(bs.draw),
+                                                max_ms(bs.draw), average_ms(bs.update), max_ms(bs.update)));
+  });
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "../block.hh"
+#include "../snapshot.hh"
+
+// Shows how much the bar itself costs: frame times, frame rate, CPU time of the
+// UI, render and libuv threads and resident memory.
+class PerfBlock : public SimpleBlock {
+  struct Sample {
+    perf::clock::time_point time;
+    std::uint64_t frames;
+    std::uint64_t frame_ns;
+    std::uint64_t update_wakeups;
+    std::uint64_t ui_wakeups;
+    std::uint64_t render_wakeups;
+    perf::clock::duration ui_cpu;
+    perf::clock::duration render_cpu;
+    perf::clock::duration loop_cpu;
+  };
+
+  Sample _last{};
+
+  struct Shown {
+    double fps = 0;
+    double frame_ms = 0;
+    double max_frame_ms = 0;
+    double ui_cpu_percent = 0;
+    double render_cpu_percent = 0;
+    double loop_cpu_percent = 0;
+    double update_wakeups_per_minute = 0;
+    double ui_wakeups_per_minute = 0;
+    double render_wakeups_per_minute = 0;
+    std::size_t rss = 0;
+  };
+  snapshot<Shown> _shown;
+
+public:
+  struct Config {
+    std::string prefix = "BAR ";
+    color prefix_color = 0xFFFFFF;
+    Interval interval = std::chrono::seconds(1);
+  };
+
+private:
+  Config _config;
+
+public:
+  PerfBlock(Config config);
+
+  size_t draw(ui::draw &, std::chrono::duration<double> delta) override;
+  void update() override;
+  Interval update_interval() override { return _config.interval; }
+  // Whenever the bar draws anything it will also draw the new numbers, we don't
+  // want measuring the bar to be the reason it is redrawn.
+  bool needs_redraw() override { return false; }
+  bool update_may_move() override { return true; }
+
+  bool has_tooltip() const override { return true; }
+  void draw_tooltip(ui::draw &, std::chrono::duration<double>, unsigned) const override;
+};
@@ -1,25 +1,19 @@
 #include <charconv>
+#include <cmath>
 #include <csignal>
 #include <cstddef>
-#include <fcntl.h>
 #include <fstream>
-#include <mutex>
-#include <spawn.h>
-#include <sys/mman.h>
-#include <sys/wait.h>
 #include <system_error>
-#include <thread>
 #include <unistd.h>
 #include <unordered_map>
 #include <uv.h>
 #include <vector>
-#include <wait.h>
 
 extern char **environ;
 
 #include "../bar.hh"
+#include "../co.hh"
 #include "../log.hh"
-#include "../run.hh"
 #include "../util.hh"
 #include "script.hh"
 
@@ -38,63 +32,14 @@ void ScriptBlock::setup_signals(std::vector<int> const &signals) {
         handle,
         [](uv_signal_t *handle, int) {
           auto *self = (ScriptBlock *)handle->data;
-          self->update();
-          bar::instance().schedule_redraw();
-          // FIXME: Why does this cause a segmentation fault??
-          // uv_timer_again(&self->_update_timer);
+          bar::instance().updates().trigger(*self);
         },
         signal);
     uv_unref((uv_handle_t *)handle);
   }
 }
 
-void ScriptBlock::update() {
-  if (_is_updating.test_and_set(std::memory_order::acq_rel)) {
-    debug << "Update skipped: already running\n";
-    return;
-  }
-
-  // uv_pipe_init(uv_default_loop(), &_child_output_stream, false);
-  // _child_output_buffer_real_size = 0;
-  // _child_output_stream.data = this;
-  // _child_process.data = this;
-  // uv_process_options_t options{};
-  // uv_stdio_container_t child_stdio[2];
-  // child_stdio[0].flags = UV_IGNORE;
-  // child_stdio[1].flags = (uv_stdio_flags)(UV_CREATE_PIPE | UV_WRITABLE_PIPE);
-  // child_stdio[1].data.stream = (uv_stream_t *)&_child_output_stream;
-  // options.stdio = child_stdio;
-  // options.stdio_count = 2;
-  // char *args[2];
-  // args[0] = strdup(_path.c_str());
-  // args[1] = NULL;
-  // DEFER([args] { free(args[0]); });
-  // options.args = args;
-  // options.file = _path.c_str();
-  // options.exit_cb = [](uv_process_t *process, int64_t status, int signal) {
-  //   auto *self = (ScriptBlock *)process->data;
-  //
-  //   uv_close((uv_handle_t *)process,
-  //            [](uv_handle_t *handle) { (void)((ScriptBlock *)handle->data)->_close_synchronizer.arrive(); });
-  //   uv_close((uv_handle_t *)&self->_child_output_stream,
-  //            [](uv_handle_t *handle) { (void)((ScriptBlock *)handle->data)->_close_synchronizer.arrive(); });
-  //
-  //   {
-  //     std::unique_lock lg(self->_result_mutex);
-  //     if (signal)
-  //       self->_result = Signaled{signal};
-  //     else if (status)
-  //       self->_result = NonZeroExit{(int)status};
-  //     else {
-  //       while (self->_child_output_buffer_real_size > 0 &&
-  //              std::isspace(self->_child_output_buffer[self->_child_output_buffer_real_size - 1]))
-  //         self->_child_output_buffer_real_size -= 1;
-  //       self->_child_output_buffer.resize(self->_child_output_buffer_real_size);
-  //       self->_result = SuccessR{self->_child_output_buffer};
-  //     }
-  //   }
-  // };
-  //
+co::task<> ScriptBlock::update_async() {
   std::vector<char *> env;
   if (_inherit_environment_variables)
     for (char **cur = environ; *cur; ++cur)
@@ -103,43 +48,80 @@ void ScriptBlock::update() {
   for (auto &var : _extra_environment_variables)
     env.push_back(var.data());
 
+  std::string button, steps;
+  if (auto clicked = std::exchange(_clicked, std::nullopt)) {
+    button = fmt::format("BLOCK_BUTTON={}", *clicked);
+  } else if (int scrolled = (int)_scrolled; scrolled != 0) {
+    // Whatever is left of a step is kept for the next time.
+    _scrolled -= scrolled;
+    button = fmt::format("BLOCK_BUTTON={}", scrolled > 0 ? 4 : 5);
+    steps = fmt::format("BLOCK_SCROLL={}", std::abs(scrolled));
+  }
+  if (!button.empty())
+    env.push_back(button.data());
+  if (!steps.empty())
+    env.push_back(steps.data());
+
   env.push_back(nullptr);
 
-  run(&_process, {_path}, env, [this](int64_t status, int signal, std::string output) {
-    _is_updating.clear(std::memory_order::release);
-    std::unique_lock lg(_result_mutex);
-    if (signal)
-      _result = Signaled{signal};
-    else if (status)
-      _result = NonZeroExit{(int)status};
+  Result result;
+  try {
+    std::vector<std::string> argv{_path};
+    auto process = co_await co::run(std::move(argv), std::move(env));
+    if (process.signal)
+      result = Signaled{process.signal};
+    else if (process.status)
+      result = NonZeroExit{(int)process.status};
     else
-      _result = SuccessR{std::string(trim(output))};
-  });
-
-  //
-  // if (int err = uv_spawn(uv_default_loop(), &_child_process, &options); err < 0) {
-  //   _is_updating.clear(std::memory_order::release);
-  //   throw std::runtime_error("libuv spawn failed: " + std::string(uv_strerror(err)));
-  // }
-  //
-  // uv_read_start((uv_stream_t *)&_child_output_stream,
-  //               [](uv_handle_t *handle, size_t size, uv_buf_t *buf) {
-  //                 auto *self = (ScriptBlock *)handle->data;
-  //                 self->_child_output_buffer.resize(self->_child_output_buffer_real_size + size);
-  //                 buf->base = self->_child_output_buffer.data() + self->_child_output_buffer_real_size;
-  //                 buf->len = size;
-  //               },
-  //               [](uv_stream_t *stream, ssize_t nread, uv_buf_t const *) {
-  //                 auto *self = (ScriptBlock *)stream->data;
-  //
-  //                 if (nread == UV_EOF)
-  //                   return;
-  //                 else if (nread < 0)
-  //                   error << "Reading child pipe failed!\n";
-  //                 else {
-  //                   self->_child_output_buffer_real_size += nread;
-  //                 }
-  //               });
+      result = SuccessR{std::string(trim(process.output))};
+  } catch (std::system_error const &e) {
+    result = SpawnFailed{e.code().value()};
+  }
+
+  bool same = _last_result.index() == result.index() &&
+              (!std::holds_alternative<SuccessR>(result) ||
+               std::get<SuccessR>(_last_result).output == std::get<SuccessR>(result).output);
+  if (!same)
+    _result_changed = true;
+
+  _last_result = result;
+  _result.publish(std::move(result));
+
+  // Scrolled while handling a click, or the other way around.
+  if (_clicked || std::abs(_scrolled) >= 1)
+    bar::instance().updates().trigger(*this);
+}
+
+void ScriptBlock::click(ui::draw::pos_t, int button) {
+  if (!_handle_clicks)
+    return;
+
+  switch (button) {
+  case GLFW_MOUSE_BUTTON_LEFT:
+    _clicked = 1;
+    break;
+  case GLFW_MOUSE_BUTTON_MIDDLE:
+    _clicked = 2;
+    break;
+  case GLFW_MOUSE_BUTTON_RIGHT:
+    _clicked = 3;
+    break;
+  default:
+    return;
+  }
+  // If the script is running right now it is run again once it's done, any
+  // clicks in between are handled by that one run.
+  bar::instance().updates().trigger(*this);
+}
+
+void ScriptBlock::scroll(ui::draw::pos_t, double, double dy) {
+  if (!_handle_clicks)
+    return;
+
+  // Touchpads scroll by fractions of a step.
+  _scrolled += dy;
+  if (std::abs(_scrolled) >= 1)
+    bar::instance().updates().trigger(*this);
 }
 
 ui::draw::pos_t draw_text_with_ansi_color(ui::draw::pos_t x, ui::draw::pos_t const y, ui::draw &draw,
@@ -221,7 +203,6 @@ bail:;
 }
 
 size_t ScriptBlock::draw(ui::draw &draw, std::chrono::duration<double>) {
-  std::unique_lock lock(_result_mutex);
   return std::visit(
       overloaded{[&draw](SuccessR const &s) { return draw_text_with_ansi_color(0, draw.vcenter(), draw, s.output); },
                  [&draw](TimedOut) { return draw.text(0, draw.vcenter(), "TIMED OUT", 0xFF0000); },
@@ -236,5 +217,5 @@ size_t ScriptBlock::draw(ui::draw &draw, std::chrono::duration<double>) {
                    else
                      return draw.text(0, draw.vcenter(), fmt::format("{}", name), 0xFF0000);
                  }},
-      _result);
+      _result.read());
 }
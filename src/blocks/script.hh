@@ -1,34 +1,37 @@
 #pragma once
 
 #include <atomic>
-#include <barrier>
 #include <chrono>
 #include <csignal>
 #include <cstddef>
 #include <filesystem>
-#include <mutex>
 #include <optional>
 #include <string>
 #include <unordered_map>
 #include <uv.h>
+#include <utility>
 #include <variant>
 #include <vector>
 
 #include <fmt/core.h>
 
 #include "../block.hh"
-#include "../run.hh"
+#include "../co.hh"
+#include "../snapshot.hh"
 #include "../util.hh"
 
-class ScriptBlock : public SimpleBlock {
+class ScriptBlock : public AsyncBlock {
   std::filesystem::path _path;
   Interval _interval;
+  Interval _max_interval;
   std::list<uv_signal_t> _signal_handles;
   std::vector<std::string> _extra_environment_variables;
   bool _inherit_environment_variables;
+  bool _handle_clicks;
 
-  std::atomic_flag _is_updating;
-  nuv_process _process;
+  // Clicks and scrolling that the next run should tell the script about.
+  std::optional<int> _clicked;
+  double _scrolled = 0;
 
   // Success is a macro... is this X's fault?
   struct SuccessR {
@@ -45,8 +48,12 @@ class ScriptBlock : public SimpleBlock {
     int signal;
   };
 
-  std::mutex _result_mutex;
-  std::variant<SuccessR, TimedOut, SpawnFailed, NonZeroExit, Signaled> _result;
+  using Result = std::variant<SuccessR, TimedOut, SpawnFailed, NonZeroExit, Signaled>;
+  // Only touched by the loop thread, draw() reads _result.
+  Result _last_result;
+  snapshot<Result> _result;
+  // Set when the last run produced a different result than the one before it.
+  bool _result_changed = true;
 
 public:
   struct Config {
@@ -55,11 +62,21 @@ public:
     std::vector<int> update_signals{};
     std::unordered_map<std::string, std::string> extra_environment_variables{};
     bool inherit_environment_variables = true;
+    // If set, the interval is stretched up to this while the script's output
+    // doesn't change, any of the update signals resets it.
+    std::optional<Interval> max_interval{};
+    // Clicking or scrolling over the block runs the script right away with
+    // BLOCK_BUTTON set like i3blocks does (1 left, 2 middle, 3 right, 4 scroll
+    // up, 5 scroll down). Scrolling is batched, BLOCK_SCROLL says by how many
+    // steps, a script that changes the volume should change it that many times.
+    bool handle_clicks = false;
   };
 
   ScriptBlock(Config &&config)
       : _path(std::move(config.path)), _interval(std::move(config.interval)),
-        _inherit_environment_variables(config.inherit_environment_variables)  {
+        _max_interval(config.max_interval.value_or(_interval)),
+        _inherit_environment_variables(config.inherit_environment_variables),
+        _handle_clicks(config.handle_clicks) {
     setup_signals(config.update_signals);
 
     for (auto const &[name, value] : config.extra_environment_variables) {
@@ -73,8 +90,13 @@ public:
 
   size_t draw(ui::draw &, std::chrono::duration<double> delta) override;
   bool skip() override {
-    return std::holds_alternative<SuccessR>(_result) && std::get<SuccessR>(_result).output.empty();
+    auto const &result = _result.read();
+    return std::holds_alternative<SuccessR>(result) && std::get<SuccessR>(result).output.empty();
   }
-  void update() override;
+  co::task<> update_async() override;
+  void click(ui::draw::pos_t, int button) override;
+  void scroll(ui::draw::pos_t, double, double dy) override;
   Interval update_interval() override { return _interval; }
+  Interval max_update_interval() override { return _max_interval; }
+  bool needs_redraw() override { return std::exchange(_result_changed, false); }
 };
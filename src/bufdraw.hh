@@ -112,3 +112,38 @@ public:
   pos_t text(pos_t x, pos_t y, std::string_view text, color = color::rgb(0xFFFFFF)) final override;
   uvec2 textsz(std::string_view text) final override;
 };
+
+// Draws straight into another draw with everything moved right by a fixed
+// offset, for placing a block whose position is already known without
+// recording it first.
+class OffsetDraw final : public ui::draw {
+  ui::draw &_draw;
+  pos_t _offset;
+
+public:
+  OffsetDraw(ui::draw &draw, pos_t offset) : _draw(draw), _offset(offset) {}
+
+  pos_t height() const override { return _draw.height(); }
+  pos_t width() const override { return _draw.width(); }
+
+  pos_t vcenter() const override { return _draw.vcenter(); }
+  pos_t hcenter() const override { return _draw.hcenter(); }
+
+  void line(pos_t x1, pos_t y1, pos_t x2, pos_t y2, color c = color::rgb(0xFFFFFF)) override {
+    _draw.line(x1 + _offset, y1, x2 + _offset, y2, c);
+  }
+
+  void hrect(pos_t x, pos_t y, pos_t w, pos_t h, color c = color::rgb(0xFFFFFF)) override {
+    _draw.hrect(x + _offset, y, w, h, c);
+  }
+  void frect(pos_t x, pos_t y, pos_t w, pos_t h, color c = color::rgb(0xFFFFFF)) override {
+    _draw.frect(x + _offset, y, w, h, c);
+  }
+
+  void fcircle(pos_t x, pos_t y, pos_t d, color c) override { _draw.fcircle(x + _offset, y, d, c); }
+
+  pos_t text(pos_t x, pos_t y, std::string_view text, color c = color::rgb(0xFFFFFF)) override {
+    return _draw.text(x + _offset, y, text, c);
+  }
+  uvec2 textsz(std::string_view text) override { return _draw.textsz(text); }
+};
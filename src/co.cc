@@ -0,0 +1,219 @@
+#include <cerrno>
+#include <fcntl.h>
+#include <system_error>
+#include <unistd.h>
+
+#include "co.hh"
+#include "log.hh"
+
+namespace co {
+
+void throw_uv_error(int error, std::string const &what) {
+  throw std::system_error(-error, std::generic_category(), what);
+}
+
+// The handle's data has to point at the coroutine.
+static void close_and_resume(uv_handle_t *handle) {
+  uv_close(handle, [](uv_handle_t *handle) { std::coroutine_handle<>::from_address(handle->data).resume(); });
+}
+
+void sleep::await_suspend(std::coroutine_handle<> waiting) {
+  uv_timer_init(uv_default_loop(), &_timer);
+  _timer.data = waiting.address();
+  uv_timer_start(&_timer, [](uv_timer_t *timer) { close_and_resume((uv_handle_t *)timer); }, _timeout, 0);
+}
+
+bool poll::await_suspend(std::coroutine_handle<> waiting) {
+  // Nothing was initialized if this fails, so there is nothing to close either.
+  if (int err = uv_poll_init(uv_default_loop(), &_poll, _fd); err < 0) {
+    _status = err;
+    return false;
+  }
+
+  _waiting = waiting;
+  _poll.data = this;
+  uv_poll_start(&_poll, _events, [](uv_poll_t *handle, int status, int events) {
+    auto *self = (poll *)handle->data;
+    self->_status = status;
+    self->_ready = events;
+    uv_poll_stop(handle);
+    handle->data = self->_waiting.address();
+    close_and_resume((uv_handle_t *)handle);
+  });
+  return true;
+}
+
+int poll::await_resume() const {
+  if (_status < 0)
+    throw_uv_error(_status, "poll");
+  return _ready;
+}
+
+run::run(std::vector<std::string> argv, std::vector<char *> env) : _argv(std::move(argv)), _env(std::move(env)) {}
+
+void run::_close(uv_handle_t *handle) {
+  if (uv_is_closing(handle))
+    return;
+  uv_close(handle, [](uv_handle_t *handle) {
+    auto *self = (run *)handle->data;
+    if (--self->_open == 0)
+      self->_waiting.resume();
+  });
+}
+
+// The pipe is non-blocking, take whatever the process wrote before it exited
+// without waiting for EOF.
+void run::_drain() {
+  uv_os_fd_t fd;
+  if (uv_is_closing((uv_handle_t *)&_pipe) || uv_fileno((uv_handle_t *)&_pipe, &fd) < 0)
+    return;
+
+  while (true) {
+    _result.output.resize(_length + 4096);
+    ssize_t n = ::read(fd, _result.output.data() + _length, 4096);
+    if (n <= 0)
+      break;
+    _length += n;
+  }
+}
+
+void run::await_suspend(std::coroutine_handle<> waiting) {
+  _waiting = waiting;
+  auto *loop = uv_default_loop();
+
+  uv_pipe_init(loop, &_pipe, false);
+  _process.data = this;
+  _pipe.data = this;
+
+  uv_process_options_t options{};
+  uv_stdio_container_t child_stdio[2];
+  child_stdio[0].flags = UV_IGNORE;
+  child_stdio[1].flags = (uv_stdio_flags)(UV_CREATE_PIPE | UV_WRITABLE_PIPE);
+  child_stdio[1].data.stream = (uv_stream_t *)&_pipe;
+  options.stdio = child_stdio;
+  options.stdio_count = 2;
+
+  std::vector<char *> cargv;
+  for (auto &arg : _argv)
+    cargv.push_back(arg.data());
+  cargv.push_back(NULL);
+  options.args = cargv.data();
+  options.file = cargv[0];
+  options.env = _env.data();
+
+  options.exit_cb = [](uv_process_t *process, int64_t status, int signal) {
+    auto *self = (run *)process->data;
+    self->_result.status = status;
+    self->_result.signal = signal;
+
+    // Anything the process started in the background may have inherited the
+    // pipe and keep it open, so it's closed right away instead of at EOF.
+    self->_drain();
+    self->_close((uv_handle_t *)&self->_pipe);
+    self->_close((uv_handle_t *)process);
+  };
+
+  _open = 2;
+  if (int err = uv_spawn(loop, &_process, &options); err < 0) {
+    // The process handle has to be closed even though nothing was spawned.
+    _spawn_error = err;
+    _close((uv_handle_t *)&_process);
+    _close((uv_handle_t *)&_pipe);
+    return;
+  }
+
+  uv_read_start(
+      (uv_stream_t *)&_pipe,
+      [](uv_handle_t *handle, size_t size, uv_buf_t *buf) {
+        auto *self = (run *)handle->data;
+        self->_result.output.resize(self->_length + size);
+        buf->base = self->_result.output.data() + self->_length;
+        buf->len = size;
+      },
+      [](uv_stream_t *stream, ssize_t nread, uv_buf_t const *) {
+        auto *self = (run *)stream->data;
+        if (nread > 0)
+          self->_length += nread;
+        else if (nread < 0) {
+          if (nread != UV_EOF)
+            fmt::print(error, "Reading from {} failed: {}\n", self->_argv[0], uv_strerror(nread));
+          self->_close((uv_handle_t *)stream);
+        }
+      });
+}
+
+process_result run::await_resume() {
+  if (_spawn_error < 0)
+    throw_uv_error(_spawn_error, "Spawning " + _argv[0]);
+  _result.output.resize(_length);
+  return std::move(_result);
+}
+
+namespace {
+
+// Awaits a single uv_fs_* request, start gets the request and the callback to
+// pass to the uv_fs_* function and returns what it returned.
+template <typename Start> class fs_request {
+  uv_fs_t _req;
+  Start _start;
+  char const *_what;
+
+public:
+  fs_request(Start start, char const *what) : _start(std::move(start)), _what(what) {}
+  BAR_NON_COPYABLE(fs_request);
+  BAR_NON_MOVEABLE(fs_request);
+
+  bool await_ready() const noexcept { return false; }
+  bool await_suspend(std::coroutine_handle<> waiting) {
+    _req.data = waiting.address();
+    int err = _start(&_req, [](uv_fs_t *req) { std::coroutine_handle<>::from_address(req->data).resume(); });
+    // The callback is not called if the request couldn't even be started.
+    if (err < 0) {
+      _req.result = err;
+      return false;
+    }
+    return true;
+  }
+  ssize_t await_resume() {
+    ssize_t result = _req.result;
+    uv_fs_req_cleanup(&_req);
+    if (result < 0)
+      throw_uv_error(result, _what);
+    return result;
+  }
+};
+
+} // namespace
+
+task<std::string> read_file(std::filesystem::path path) {
+  auto *loop = uv_default_loop();
+
+  auto fd = (uv_file)co_await fs_request(
+      [&](uv_fs_t *req, uv_fs_cb cb) { return uv_fs_open(loop, req, path.c_str(), O_RDONLY | O_CLOEXEC, 0, cb); },
+      "open");
+
+  std::string content;
+  std::exception_ptr exception;
+  try {
+    while (true) {
+      auto offset = content.size();
+      content.resize(offset + 4096);
+      uv_buf_t buf = uv_buf_init(content.data() + offset, 4096);
+      auto n = co_await fs_request(
+          [&](uv_fs_t *req, uv_fs_cb cb) { return uv_fs_read(loop, req, fd, &buf, 1, offset, cb); }, "read");
+      content.resize(offset + n);
+      if (n == 0)
+        break;
+    }
+  } catch (...) {
+    // Can't co_await inside of a handler.
+    exception = std::current_exception();
+  }
+
+  co_await fs_request([&](uv_fs_t *req, uv_fs_cb cb) { return uv_fs_close(loop, req, fd, cb); }, "close");
+  if (exception)
+    std::rethrow_exception(exception);
+  co_return content;
+}
+
+} // namespace co
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <uv.h>
+
+#include "util.hh"
+
+// Coroutines on top of the libuv loop.
+//
+// Everything in here has to be used from the loop thread. Awaiting one of the
+// awaiters below suspends the coroutine until libuv is done with the handle or
+// request, the handles live inside the awaiter and are always closed again
+// before the coroutine is resumed, so nothing outlives the co_await.
+//
+// Errors reported by libuv are thrown as std::system_error with the positive
+// errno value as code.
+namespace co {
+
+template <typename T = void> class task;
+
+namespace _private {
+
+struct promise_base {
+  std::coroutine_handle<> continuation = std::noop_coroutine();
+  std::exception_ptr exception;
+
+  // Tasks are lazy, they run once they are awaited.
+  std::suspend_always initial_suspend() noexcept { return {}; }
+
+  struct final_awaiter {
+    bool await_ready() noexcept { return false; }
+    template <typename P> std::coroutine_handle<> await_suspend(std::coroutine_handle<P> self) noexcept {
+      return self.promise().continuation;
+    }
+    void await_resume() noexcept {}
+  };
+  final_awaiter final_suspend() noexcept { return {}; }
+
+  void unhandled_exception() { exception = std::current_exception(); }
+};
+
+template <typename T> struct promise : promise_base {
+  std::optional<T> value;
+
+  task<T> get_return_object();
+  void return_value(T v) { value.emplace(std::move(v)); }
+  T result() {
+    if (exception)
+      std::rethrow_exception(exception);
+    return std::move(*value);
+  }
+};
+
+template <> struct promise<void> : promise_base {
+  task<void> get_return_object();
+  void return_void() {}
+  void result() {
+    if (exception)
+      std::rethrow_exception(exception);
+  }
+};
+
+// Started right away and owns itself, exceptions escape to whoever resumed it
+// last, that is out of the libuv callback, like they do from plain callbacks.
+struct detached {
+  struct promise_type {
+    detached get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { throw; }
+  };
+};
+
+} // namespace _private
+
+// A coroutine producing a T, it starts running when it is co_awaited and
+// resumes the awaiting coroutine when it finishes.
+template <typename T> class task {
+public:
+  using promise_type = _private::promise<T>;
+
+private:
+  std::coroutine_handle<promise_type> _handle;
+
+public:
+  explicit task(std::coroutine_handle<promise_type> handle) : _handle(handle) {}
+  task(task &&other) : _handle(std::exchange(other._handle, nullptr)) {}
+  task &operator=(task &&other) {
+    std::swap(_handle, other._handle);
+    return *this;
+  }
+  BAR_NON_COPYABLE(task);
+  ~task() {
+    if (_handle)
+      _handle.destroy();
+  }
+
+  bool await_ready() const noexcept { return false; }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+    _handle.promise().continuation = caller;
+    return _handle;
+  }
+  T await_resume() { return _handle.promise().result(); }
+};
+
+template <typename T> task<T> _private::promise<T>::get_return_object() {
+  return task<T>(std::coroutine_handle<promise<T>>::from_promise(*this));
+}
+inline task<void> _private::promise<void>::get_return_object() {
+  return task<void>(std::coroutine_handle<promise<void>>::from_promise(*this));
+}
+
+// Runs the task to completion without anyone waiting for it.
+template <typename T> _private::detached spawn(task<T> work) { co_await std::move(work); }
+
+[[noreturn]] void throw_uv_error(int error, std::string const &what);
+
+// Resumes after the given time has passed.
+class sleep {
+  uv_timer_t _timer;
+  std::uint64_t _timeout;
+
+public:
+  explicit sleep(std::chrono::milliseconds timeout) : _timeout(std::max<std::int64_t>(timeout.count(), 0)) {}
+  BAR_NON_COPYABLE(sleep);
+  BAR_NON_MOVEABLE(sleep);
+
+  bool await_ready() const noexcept { return _timeout == 0; }
+  void await_suspend(std::coroutine_handle<>);
+  void await_resume() const noexcept {}
+};
+
+// Resumes once the file descriptor is ready for any of the given UV_READABLE,
+// UV_WRITABLE, ... events and returns which ones it is ready for.
+class poll {
+  uv_poll_t _poll;
+  int _fd;
+  int _events;
+  int _status = 0;
+  int _ready = 0;
+  std::coroutine_handle<> _waiting;
+
+public:
+  poll(int fd, int events) : _fd(fd), _events(events) {}
+  BAR_NON_COPYABLE(poll);
+  BAR_NON_MOVEABLE(poll);
+
+  bool await_ready() const noexcept { return false; }
+  bool await_suspend(std::coroutine_handle<>);
+  int await_resume() const;
+};
+
+struct process_result {
+  std::int64_t status = 0;
+  // The signal that killed the process, zero if it exited.
+  int signal = 0;
+  // Everything the process wrote to its standard output.
+  std::string output;
+};
+
+// Spawns a process and resumes once it has exited. env must be terminated by a
+// null pointer like execve's, stdin is /dev/null and stderr is inherited.
+class run {
+  std::vector<std::string> _argv;
+  std::vector<char *> _env;
+
+  uv_process_t _process{};
+  uv_pipe_t _pipe{};
+  std::size_t _length = 0;
+  process_result _result;
+  int _spawn_error = 0;
+
+  // Handles that have not been closed yet, the coroutine is resumed after the last one.
+  int _open = 0;
+  std::coroutine_handle<> _waiting;
+
+  void _close(uv_handle_t *);
+  void _drain();
+
+public:
+  run(std::vector<std::string> argv, std::vector<char *> env);
+  BAR_NON_COPYABLE(run);
+  BAR_NON_MOVEABLE(run);
+
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<>);
+  process_result await_resume();
+};
+
+// Reads a whole file through libuv's thread pool, so reading it never blocks
+// the loop thread.
+task<std::string> read_file(std::filesystem::path path);
+
+} // namespace co
@@ -1,6 +1,10 @@
 #pragma once
 
-#include <variant>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
 
 #include "util.hh"
 
@@ -43,58 +47,51 @@ struct color {
   };
 
 private:
-  std::variant<rgb, hsl> _value;
-  std::variant<std::monostate, rgb, hsl> _cache;
+  // 0xRRGGBBAA, hsl colours are converted when the color is constructed so
+  // that reading the colour back on the hot path is just a couple of shifts.
+  std::uint32_t _packed;
+
+  constexpr static std::uint32_t _pack(struct rgb c, unsigned char a = 0xFF) {
+    return (std::uint32_t(c.r) << 24) | (std::uint32_t(c.g) << 16) | (std::uint32_t(c.b) << 8) | a;
+  }
 
 public:
-  constexpr color() : _value(rgb(0, 0, 0)) {}
-  constexpr color(unsigned long rgb) : _value((struct rgb)(rgb)) {}
-  constexpr color(rgb c) : _value(c) {}
-  constexpr color(hsl c) : _value(c) {}
+  constexpr color() : _packed(_pack(rgb(0, 0, 0))) {}
+  constexpr color(unsigned long rgb) : _packed(_pack((struct rgb)(rgb))) {}
+  constexpr color(rgb c) : _packed(_pack(c)) {}
+  constexpr color(hsl c) : _packed(_pack(rgb(c))) {}
 
   constexpr color(color const &) = default;
   constexpr color(color &&) = default;
   constexpr color &operator=(color const &) = default;
   constexpr color &operator=(color &&) = default;
 
-  constexpr bool operator==(color const &other) const {
-    return std::visit(overloaded{[&](rgb const &r) { return r == rgb(other); },
-                                 [&](hsl const &h) { return h == hsl(other); }},
-                      _value);
+  constexpr static color from_packed(std::uint32_t packed) {
+    color c;
+    c._packed = packed;
+    return c;
   }
+
+  constexpr bool operator==(color const &other) const { return _packed == other._packed; }
   constexpr bool operator!=(color const &other) const {
     return !(*this == other);
   }
 
-  constexpr auto value() const { return _value; }
-
-  constexpr operator rgb() const {
-    return std::visit(
-        overloaded{[](rgb const &v) { return v; },
-                   [this](hsl const &v) {
-                     return std::visit(
-                         overloaded{[](rgb const &cached) { return cached; },
-                                    [&v](auto) { return rgb(v); }},
-                         _cache);
-                   }},
-        _value);
-  }
-  constexpr operator hsl() const {
-    return std::visit(
-        overloaded{[](hsl const &v) { return v; },
-                   [this](rgb const &v) {
-                     return std::visit(
-                         overloaded{[](hsl const &cached) { return cached; },
-                                    [&v](auto) { return hsl(v); }},
-                         _cache);
-                   }},
-        _value);
-  }
+  constexpr std::uint32_t packed() const { return _packed; }
+  constexpr unsigned char r() const { return _packed >> 24; }
+  constexpr unsigned char g() const { return _packed >> 16; }
+  constexpr unsigned char b() const { return _packed >> 8; }
+  constexpr unsigned char a() const { return _packed; }
+
+  constexpr operator rgb() const { return rgb(r(), g(), b()); }
+  constexpr operator hsl() const { return hsl(rgb(*this)); }
 
   constexpr auto as_rgb() const { return (struct rgb)(*this); }
   constexpr auto as_hsl() const { return (struct hsl)(*this); }
 };
 
+static_assert(sizeof(color) == 4);
+
 namespace std {
 template <> struct hash<color::rgb> {
   size_t operator()(color::rgb const &c) const {
@@ -110,13 +107,7 @@ template <> struct hash<color::hsl> {
   }
 };
 template <> struct hash<color> {
-  size_t operator()(color const &c) const {
-    return std::visit(
-        overloaded{
-            [](color::rgb const &v) { return std::hash<color::rgb>()(v); },
-            [](color::hsl const &v) { return std::hash<color::hsl>()(v); }},
-        c.value());
-  }
+  size_t operator()(color const &c) const { return std::hash<std::uint32_t>()(c.packed()); }
 };
 }; // namespace std
 
@@ -169,3 +160,45 @@ constexpr color::hsl::hsl(rgb r) {
     h /= 6;
   }
 }
+
+// A colour gradient sampled at compile time, picking the colour for a value
+// is then just a table lookup instead of a HSL to RGB conversion.
+template <std::size_t N = 256> class color_gradient {
+  std::array<color, N> _table;
+
+  constexpr static std::size_t _index(double fraction) {
+    // Also catches NaN
+    if (!(fraction > 0))
+      return 0;
+    if (fraction >= 1)
+      return N - 1;
+    return std::size_t(fraction * (N - 1) + 0.5);
+  }
+
+public:
+  template <typename F>
+    requires std::is_invocable_r_v<color, F, double>
+  constexpr color_gradient(F &&f) : _table() {
+    for (std::size_t i = 0; i < N; ++i)
+      _table[i] = f(double(i) / (N - 1));
+  }
+
+  // fraction is clamped to [0, 1].
+  constexpr color operator()(double fraction) const { return _table[_index(fraction)]; }
+
+  // Bulk version for drawing many bars at once.
+  void operator()(std::span<double const> fractions, std::span<color> out) const {
+    assert(out.size() >= fractions.size());
+    for (std::size_t i = 0; i < fractions.size(); ++i)
+      out[i] = _table[_index(fractions[i])];
+  }
+};
+
+namespace gradients {
+
+// Green at 0 to red at 1, for things like CPU usage.
+inline constexpr color_gradient<> usage([](double t) { return color::hsl((1 - t) * 120 / 360., 1, .5); });
+// Red at 0 to green at 1, for things like battery charge or free disk space.
+inline constexpr color_gradient<> level([](double t) { return color::hsl(t * 100 / 360., .9, .45); });
+
+} // namespace gradients
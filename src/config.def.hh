@@ -11,7 +11,9 @@
 #endif
 #include "blocks/memory.hh"
 #include "blocks/network.hh"
+#include "blocks/perf.hh"
 #include "blocks/script.hh"
+#include "static_blocks.hh"
 
 #include <csignal>
 #include <cstddef>
@@ -32,6 +34,66 @@ constexpr int init_platform_order[] = {GLFW_ANY_PLATFORM};
 
 constexpr color background_color = color::rgb(0, 0, 0);
 
+// The bar is redrawn at least this often, this is what drives block animations.
+constexpr static auto animation_interval = 48ms;
+// Upper limit on how many frames per second are drawn when redraws are requested
+// more often (by block updates, hovering over blocks, ...).
+constexpr static double max_fps = 60;
+// Periodic block updates happen on multiples of this, update intervals are rounded to
+// a multiple of it so that blocks with related intervals are updated in the same wakeup.
+constexpr static auto update_tick = 100ms;
+// Blocks reading the same file (/proc/stat...) share a sample that was taken at most
+// this long ago instead of reading it again, see samplers::source.
+constexpr static auto sample_max_age = update_tick / 2;
+// How the bar slows itself down depending on the power source, see power::profile.
+constexpr power::profile ac_profile{};
+constexpr power::profile battery_profile{.frame_rate = 0.5, .animation_rate = 0.5, .update_interval = 2};
+// Applied on top of one of the above when there was no user input for idle_after,
+// only detected on X11 if the bar was built with the XScreenSaver extension.
+constexpr power::profile idle_profile{.frame_rate = 0.5, .animation_rate = 0.25, .update_interval = 2};
+constexpr static auto idle_after = 2min;
+// How often the power source and idle state are checked.
+constexpr static auto power_poll_interval = 2s;
+// Blocks whose updates may block (DiskBlock's statfs on a hung network mount...) are
+// updated on worker threads, after this long without an update finishing they are shown as stale.
+constexpr static auto blocking_update_deadline = 2s;
+// While the bar is hidden (covered, iconified, the outputs are off...) nothing is
+// drawn and blocks are updated at most this often.
+constexpr static auto hidden_update_interval = 60s;
+// On Wayland the bar is considered hidden when the compositor doesn't answer a
+// frame callback for this long.
+constexpr static auto hidden_after = 1s;
+// Passed to glfwSwapInterval, 0 means buffer swaps never wait for vblank.
+// Ignored on Wayland where the compositor paces frames through frame callbacks.
+constexpr static int swap_interval = 0;
+// Handle the display connection and draw the bar on the libuv loop thread instead of
+// separate UI and render threads. Saves the wakeups between the threads, but a slow frame
+// now delays block updates and the other way around. Keep swap_interval at 0 with this.
+constexpr static bool single_threaded = false;
+
+// The watchdog logs whatever takes longer than its budget and deals with blocks
+// whose updates keep doing so.
+namespace watchdog {
+
+// How often the loop lag is measured and blocks are checked, 0s disables the watchdog.
+constexpr static auto interval = 1s;
+// The loop thread getting around to the watchdog this much later than planned is
+// reported as loop lag, it delays every block update (and frame in single_threaded mode).
+constexpr static auto loop_lag_budget = 50ms;
+// Budgets for a single update() of a block on the loop thread and a single draw().
+constexpr static auto update_budget = 20ms;
+constexpr static auto draw_budget = 4ms;
+// A block that went over its update budget in this many checks in a row has its
+// updates moved to a worker thread if it supports that (see SimpleBlock::update_may_move),
+// otherwise its update interval is doubled up to max_widening times the configured one.
+constexpr static unsigned strikes = 3;
+constexpr static bool offload = true;
+constexpr static double max_widening = 8;
+// The same complaint about the same block is logged at most this often.
+constexpr static auto log_interval = 30s;
+
+} // namespace watchdog
+
 // Configuration options specific to the X11 backend
 namespace x11 {
 
@@ -39,6 +101,8 @@ namespace x11 {
 constexpr static size_t height = 48;
 // Whether to set the override-redirect flag on the bar window.
 constexpr static bool override_redirect = true;
+// How often the DPMS state of the outputs is checked, nothing is drawn while they are off.
+constexpr static auto dpms_poll_interval = 2s;
 // The window name of the bar window.
 constexpr static std::string_view window_name = "bar";
 // The class name of the bar window.
@@ -77,7 +141,13 @@ inline void initialize(bar &bar) {
     });
     bar.add_right<CpuBlock>(CpuBlock::Config {
         .prefix = "CPU ",
-        .thermal_zone_type = "SEN1"
+        .thermal_zone_type = "SEN1",
+        // A bar per core gets wide on big machines, a heatmap of fixed width
+        // (or only the min/avg/max usage) doesn't.
+        // .view = CpuBlock::View::heatmap,
+        // Cores can also be shown together with their SMT siblings, the rest of
+        // their socket or their NUMA node.
+        // .grouping = CpuBlock::Grouping::smt,
     });
     bar.add_right<DiskBlock>("/", DiskBlock::Config {
         // If the title is not set then it's set to the mountpoint path
@@ -89,21 +159,37 @@ inline void initialize(bar &bar) {
         .bar_width = 45,
         // If the color is not set then it's chosen based on the usage percentage.
         // .bar_fill_color = 0x00FF00,
+        // While the usage stays the same the update interval is stretched up to this.
+        // .max_update_interval = 60s,
     });
     bar.add_right<ScriptBlock>(ScriptBlock::Config {
         .path = "sb-mic-volume",
         .interval = 1s,
         // The block will be updated if any of the signals in this vector are received.
-        .update_signals{SIGRTMIN + 20}
+        .update_signals{SIGRTMIN + 20},
+        // While the output stays the same the interval is stretched up to this,
+        // receiving one of the update signals resets it.
+        // .max_interval = 10s,
     });
     bar.add_right<ScriptBlock>(ScriptBlock::Config {
         .path = "sb-volume",
         .interval = 1s,
         .update_signals{44},
+        // Run the script with BLOCK_BUTTON set when the block is clicked or scrolled over.
+        // .handle_clicks = true,
         // If this flag is set (default) then if the script output would result in an empty block then the block is instead just skipped.
         // .skip_on_empty = false
     });
     bar.add_right<NetworkBlock>();
+    // Shows how much time and memory the bar itself is using.
+    // bar.add_right<PerfBlock>(PerfBlock::Config{.prefix = "BAR "});
+
+    // Blocks can also be grouped into a single static_blocks block, the types of its
+    // blocks are known at compile time so drawing them doesn't go through virtual calls.
+    // bar.add_right<static_blocks<ClockBlock, MemoryBlock>>(
+    //     std::tuple{},
+    //     std::tuple{MemoryBlock::Config{.prefix = "MEM "}}
+    // );
 }
 #endif
 // clang-format on
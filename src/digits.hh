@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+// Parses runs of decimal digits out of the integer tables the kernel generates
+// (/proc/stat, /proc/net/dev, /proc/diskstats...).
+//
+// On x86-64 the digit runs are found 16 bytes at a time with SSE2. There is an
+// AVX2 version too, but the lines in these files are short and it measured no
+// faster than SSE2 (bench/digits.cc), so it isn't picked by default. Everything
+// else uses the scalar version, all of them return the same results
+// (tests/digits_fuzz.cc).
+namespace digits {
+
+enum class kernel { scalar, sse2, avx2 };
+
+// The kernel parse() uses when none is given.
+kernel best();
+bool supported(kernel);
+std::string_view name(kernel);
+
+// Parses the numbers on the line starting at it into out, skipping whatever
+// isn't a digit in between. Stops after out.size() numbers or at the end of the
+// line, it then points at the '\n' (or end), otherwise right after the last
+// digit. Returns how many numbers were parsed, numbers that don't fit into 64
+// bits wrap around.
+std::size_t parse(kernel, char const *&it, char const *end, std::span<std::uint64_t> out);
+inline std::size_t parse(char const *&it, char const *end, std::span<std::uint64_t> out) {
+  static kernel const k = best();
+  return parse(k, it, end, out);
+}
+
+} // namespace digits
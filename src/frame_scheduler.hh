@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+// Decides when the render thread should produce the next frame.
+//
+// Keeps "a frame was requested" (by a block update, input, ...) separate from
+// "a frame was presented" so that any number of requests in between two frames
+// are coalesced into one and frames are never produced faster than the
+// configured frame budget allows.
+class frame_scheduler {
+public:
+  using clock = std::chrono::steady_clock;
+
+private:
+  // Atomic so that the power profile can change them from the loop thread.
+  std::atomic<clock::duration> _min_frame_interval{};
+  std::atomic<clock::duration> _animation_interval{};
+
+  std::atomic<bool> _requested{false};
+  // When the last presented frame started being drawn, deadlines count from it.
+  clock::time_point _last_started{};
+  clock::duration _last_frame_time{};
+
+public:
+  frame_scheduler() = default;
+
+  // Frame rates below this (zero, negative or NaN from a misconfigured power
+  // profile...) are raised to it, 1 / max_fps would not fit a duration.
+  static constexpr double min_fps = 1;
+
+  // Safe to call from any thread, takes effect from the next deadline() on.
+  void configure(double max_fps, clock::duration animation_interval) {
+    if (!(max_fps >= min_fps))
+      max_fps = min_fps;
+    _min_frame_interval.store(
+        std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1 / max_fps)),
+        std::memory_order_relaxed);
+    _animation_interval.store(animation_interval, std::memory_order_relaxed);
+  }
+
+  // Returns true if no frame was requested since the last one was presented.
+  // Safe to call from any thread.
+  bool request() { return !_requested.exchange(true, std::memory_order_acq_rel); }
+  bool requested() const { return _requested.load(std::memory_order_acquire); }
+
+  // The point in time at which the next frame should be drawn.
+  clock::time_point deadline() const {
+    auto periodic = _last_started + _animation_interval.load(std::memory_order_relaxed);
+    if (!requested())
+      return periodic;
+    return std::min(periodic, _last_started + _min_frame_interval.load(std::memory_order_relaxed));
+  }
+  bool due(clock::time_point now) const { return now >= deadline(); }
+
+  // Must be called before a frame is drawn, requests that come in while the
+  // frame is being drawn will result in another one.
+  void begin_frame() { _requested.store(false, std::memory_order_release); }
+  void presented(clock::time_point started, clock::time_point now) {
+    _last_started = started;
+    _last_frame_time = now - started;
+  }
+
+  clock::time_point last_started() const { return _last_started; }
+  clock::duration last_frame_time() const { return _last_frame_time; }
+  clock::duration animation_interval() const { return _animation_interval.load(std::memory_order_relaxed); }
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <ranges>
+#include <utility>
+#include <vector>
+
+#include "ui/draw.hh"
+
+// How much horizontal space a block is given compared to how much it draws.
+struct width_reservation {
+  // The block will never be given less space than this.
+  ui::draw::pos_t min_width = 0;
+  // When a block gets narrower it keeps its old width until it stays narrower
+  // for this long, this stops every block next to it from moving back and forth
+  // when e.g. "9.9%" turns into "10.0%" and back.
+  std::chrono::steady_clock::duration shrink_delay = std::chrono::seconds(2);
+};
+
+// Layout state of a single block that's kept across frames.
+struct layout_slot {
+  using pos_t = ui::draw::pos_t;
+  using clock = std::chrono::steady_clock;
+
+  width_reservation reservation;
+
+  pos_t x = 0;
+  // The width reserved for the block.
+  pos_t width = 0;
+  // The width the block actually used in the last frame.
+  pos_t content_width = 0;
+
+  std::optional<clock::time_point> narrower_since;
+
+  // Updates the reserved width given the width the block drew this frame.
+  void fit(pos_t natural, clock::time_point now) {
+    content_width = natural;
+    natural = std::max(natural, reservation.min_width);
+
+    if (natural >= width) {
+      width = natural;
+      narrower_since.reset();
+    } else if (!narrower_since)
+      narrower_since = now;
+    else if (now - *narrower_since >= reservation.shrink_delay) {
+      width = natural;
+      narrower_since.reset();
+    }
+  }
+};
+
+// Places blocks on the bar and answers "which block is at x?" queries.
+//
+// Blocks are added every frame in drawing order, that is from the screen edge
+// inwards for both sides. Positions are only recomputed when the sequence of
+// visible blocks or the width reserved for one of them changes.
+template <typename Key> class bar_layout {
+public:
+  using pos_t = ui::draw::pos_t;
+  using clock = std::chrono::steady_clock;
+
+  // Space between a block and a separator.
+  constexpr static pos_t separator_margin = 8;
+  constexpr static pos_t separator_width = 2;
+  // Space between the screen edge and the outermost blocks.
+  constexpr static pos_t edge_margin = 5;
+
+  struct entry {
+    Key key;
+    layout_slot *slot;
+    pos_t width;
+
+    bool operator==(entry const &other) const { return key == other.key && width == other.width; }
+  };
+
+private:
+  struct interval {
+    pos_t begin, end;
+    Key key;
+  };
+
+  std::vector<entry> _left, _right;
+  std::vector<entry> _previous_left, _previous_right;
+  pos_t _previous_total_width = 0;
+
+  // Sorted by begin, intervals never overlap.
+  std::vector<interval> _intervals;
+
+  void _layout(pos_t total_width) {
+    pos_t x = edge_margin;
+    for (auto const &e : _left) {
+      e.slot->x = x;
+      x += e.width + 2 * separator_margin + separator_width;
+    }
+
+    x = total_width - edge_margin;
+    for (auto const &e : _right) {
+      x -= e.width;
+      e.slot->x = x;
+      x -= 2 * separator_margin + separator_width;
+    }
+
+    _intervals.clear();
+    for (auto const &e : _left)
+      _intervals.push_back({e.slot->x, e.slot->x + e.width, e.key});
+    for (auto const &e : _right | std::views::reverse)
+      _intervals.push_back({e.slot->x, e.slot->x + e.width, e.key});
+  }
+
+public:
+  void begin_frame() {
+    std::swap(_left, _previous_left);
+    std::swap(_right, _previous_right);
+    _left.clear();
+    _right.clear();
+  }
+
+  void add_left(Key key, layout_slot &slot, pos_t drawn_width, clock::time_point now) {
+    slot.fit(drawn_width, now);
+    _left.push_back({key, &slot, slot.width});
+  }
+  void add_right(Key key, layout_slot &slot, pos_t drawn_width, clock::time_point now) {
+    slot.fit(drawn_width, now);
+    _right.push_back({key, &slot, slot.width});
+  }
+
+  // Runs the layout pass if anything changed since the last frame, returns
+  // whether it did.
+  bool finish(pos_t total_width) {
+    if (_left == _previous_left && _right == _previous_right && total_width == _previous_total_width)
+      return false;
+
+    _layout(total_width);
+    _previous_total_width = total_width;
+    return true;
+  }
+
+  std::vector<entry> const &left() const { return _left; }
+  std::vector<entry> const &right() const { return _right; }
+
+  // Finds the block at the given x coordinate in O(log n).
+  std::optional<Key> hit(pos_t x) const {
+    auto it = std::upper_bound(_intervals.begin(), _intervals.end(), x,
+                               [](pos_t x, interval const &i) { return x < i.begin; });
+    if (it == _intervals.begin())
+      return std::nullopt;
+    --it;
+    if (x < it->end)
+      return it->key;
+    return std::nullopt;
+  }
+};
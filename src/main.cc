@@ -28,17 +28,21 @@
 #include "bar.hh"
 #include "block.hh"
 #include "config.hh"
+#include "digits.hh"
 #include "log.hh"
+#include "perf.hh"
 #include "ui/gl.hh"
 #include "util.hh"
 
 int main() {
   std::locale::global(std::locale(""));
+  fmt::print(debug, "Parsing procfs numbers with the {} kernel\n", digits::name(digits::best()));
 
   bar &bar = bar::instance();
 
   bar.init_ui();
   config::initialize(bar);
+  perf::startup_step("blocks set up");
   bar.start_ui();
 
   uv_run(uv_default_loop(), UV_RUN_DEFAULT);
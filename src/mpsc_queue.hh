@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+#include "util.hh"
+
+// A bounded queue any number of threads can push to and one thread pops from,
+// neither side ever waits for the other: pushing to a full queue fails instead.
+//
+// Every cell carries a sequence number that says whose turn it is. A producer
+// claims a cell by advancing the tail, fills it and then bumps its sequence to
+// hand it to the consumer, which bumps it again by the capacity to hand it back
+// to the producer that will wrap around to it.
+template <typename T, std::size_t Capacity> class mpsc_queue {
+  static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+  static constexpr std::size_t mask = Capacity - 1;
+
+  struct cell {
+    std::atomic<std::size_t> sequence;
+    T value;
+  };
+
+  std::array<cell, Capacity> _cells;
+  // Producers and the consumer each get their own cache line.
+  alignas(64) std::atomic<std::size_t> _tail{0};
+  alignas(64) std::size_t _head = 0;
+
+public:
+  mpsc_queue() {
+    for (std::size_t i = 0; i < Capacity; ++i)
+      _cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  BAR_NON_COPYABLE(mpsc_queue);
+  BAR_NON_MOVEABLE(mpsc_queue);
+
+  // Safe to call from any thread, returns false if the queue is full.
+  bool push(T value) {
+    auto pos = _tail.load(std::memory_order_relaxed);
+    while (true) {
+      auto &c = _cells[pos & mask];
+      auto sequence = c.sequence.load(std::memory_order_acquire);
+      auto diff = (std::intptr_t)sequence - (std::intptr_t)pos;
+      if (diff == 0) {
+        if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          c.value = std::move(value);
+          c.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0)
+        // The consumer hasn't taken the value from the last round out yet.
+        return false;
+      else
+        pos = _tail.load(std::memory_order_relaxed);
+    }
+  }
+
+  // Must only be called from the consumer thread.
+  std::optional<T> pop() {
+    auto &c = _cells[_head & mask];
+    if (c.sequence.load(std::memory_order_acquire) != _head + 1)
+      return std::nullopt;
+
+    std::optional<T> value(std::move(c.value));
+    c.sequence.store(_head + Capacity, std::memory_order_release);
+    ++_head;
+    return value;
+  }
+};
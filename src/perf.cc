@@ -0,0 +1,66 @@
+#include "perf.hh"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "digits.hh"
+#include "log.hh"
+
+namespace perf {
+
+// Close enough to when the process started, everything before it is the
+// dynamic linker.
+static clock::time_point const process_start = clock::now();
+
+stats &global() {
+  static stats instance;
+  return instance;
+}
+
+clock::duration startup_step(std::string_view step) {
+  auto elapsed = clock::now() - process_start;
+  fmt::print(info, "Startup: {} after {:.1f}ms\n", step,
+             std::chrono::duration<double, std::milli>(elapsed).count());
+  return elapsed;
+}
+
+static clockid_t current_thread_clock() {
+  clockid_t id;
+  if (pthread_getcpuclockid(pthread_self(), &id) != 0)
+    return -1;
+  return id;
+}
+
+void stats::register_ui_thread() { ui_thread_clock.store(current_thread_clock(), std::memory_order_relaxed); }
+void stats::register_render_thread() {
+  render_thread_clock.store(current_thread_clock(), std::memory_order_relaxed);
+}
+void stats::register_loop_thread() { loop_thread_clock.store(current_thread_clock(), std::memory_order_relaxed); }
+
+clock::duration thread_cpu_time(clockid_t id) {
+  timespec ts;
+  if (id == -1 || clock_gettime(id, &ts) < 0)
+    return clock::duration::zero();
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+std::size_t resident_set_size() {
+  static int fd = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+  static long page_size = sysconf(_SC_PAGESIZE);
+
+  char buffer[128];
+  ssize_t n = fd < 0 ? -1 : pread(fd, buffer, sizeof buffer, 0);
+  if (n <= 0)
+    return 0;
+
+  // statm is "size resident shared text lib data dt" in pages
+  char const *it = buffer;
+  std::uint64_t pages[2];
+  if (digits::parse(it, buffer + n, pages) < 2)
+    return 0;
+
+  return pages[1] * page_size;
+}
+
+} // namespace perf
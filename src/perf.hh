@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string_view>
+
+// Counters the bar keeps about itself, see PerfBlock.
+//
+// Everything here is written from the hot paths so recording must stay cheap
+// and allocation-free, all counters are relaxed atomics because they are only
+// ever read for display.
+namespace perf {
+
+using clock = std::chrono::steady_clock;
+
+// Statistics about a repeated operation.
+struct timing {
+  std::atomic<std::uint64_t> count{0};
+  std::atomic<std::uint64_t> total_ns{0};
+  std::atomic<std::uint64_t> last_ns{0};
+  // Reset by whoever displays it.
+  std::atomic<std::uint64_t> max_ns{0};
+  // Operations that took longer than the budget they were recorded with, reset
+  // by the watchdog.
+  std::atomic<std::uint32_t> over_budget{0};
+
+  void record(clock::duration duration, clock::duration budget = clock::duration::max()) {
+    std::uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    count.fetch_add(1, std::memory_order_relaxed);
+    total_ns.fetch_add(ns, std::memory_order_relaxed);
+    last_ns.store(ns, std::memory_order_relaxed);
+    if (duration > budget)
+      over_budget.fetch_add(1, std::memory_order_relaxed);
+
+    auto max = max_ns.load(std::memory_order_relaxed);
+    while (max < ns && !max_ns.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+      ;
+  }
+
+  // Measures the duration of the enclosing scope.
+  class scope {
+    timing &_timing;
+    clock::duration _budget;
+    clock::time_point _start;
+
+  public:
+    scope(timing &t, clock::duration budget = clock::duration::max())
+        : _timing(t), _budget(budget), _start(clock::now()) {}
+    ~scope() { _timing.record(clock::now() - _start, _budget); }
+  };
+};
+
+struct block_stats {
+  timing draw;
+  timing update;
+};
+
+struct stats {
+  timing frames;
+  // How late the loop thread got around to the watchdog's timer.
+  timing loop_lag;
+  // From when the UI handled an input event (hovering over a block...) until
+  // the frame showing its effect was presented.
+  timing input_latency;
+  // GLFW callbacks on the UI thread, which only handles events while frames are
+  // drawn on the render thread.
+  timing events;
+
+  std::atomic<std::uint64_t> text_cache_hits{0};
+  std::atomic<std::uint64_t> text_cache_misses{0};
+  // Number of times the update scheduler woke up the loop thread.
+  std::atomic<std::uint64_t> update_wakeups{0};
+  // Number of times the UI woke up to handle display events or draw a frame.
+  std::atomic<std::uint64_t> ui_wakeups{0};
+  // Number of times the render thread woke up, see bar::_render_wait.
+  std::atomic<std::uint64_t> render_wakeups{0};
+  // From when the process started until the first frame was presented, zero
+  // until then.
+  std::atomic<std::uint64_t> first_frame_ns{0};
+
+  // CPU-time clocks of the bar's threads, see register_*_thread.
+  std::atomic<clockid_t> ui_thread_clock{-1};
+  std::atomic<clockid_t> render_thread_clock{-1};
+  std::atomic<clockid_t> loop_thread_clock{-1};
+
+  void register_ui_thread();
+  void register_render_thread();
+  void register_loop_thread();
+};
+
+stats &global();
+
+// Logs that a step of starting up finished and how long after the process
+// started that was, so time to first frame can be tracked. Safe to call from
+// any thread, returns the time since the start.
+clock::duration startup_step(std::string_view step);
+
+// CPU time consumed by the thread with the given clock so far, zero if the
+// clock is invalid.
+clock::duration thread_cpu_time(clockid_t);
+// Resident set size of the process in bytes, reads /proc/self/statm through a
+// file descriptor that's kept open so this does not allocate.
+std::size_t resident_set_size();
+
+} // namespace perf
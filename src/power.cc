@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <GLFW/glfw3.h>
+#ifdef HAVE_XSS
+#include <X11/Xlib.h>
+#include <X11/extensions/scrnsaver.h>
+#endif
+
+#include "config.hh"
+#include "log.hh"
+#include "power.hh"
+#include "sysfs_attr.hh"
+
+namespace power {
+
+std::vector<std::filesystem::path> find_supplies(std::string_view type) {
+  std::vector<std::filesystem::path> result;
+  std::error_code ec;
+  for (auto &entry : std::filesystem::directory_iterator("/sys/class/power_supply", ec)) {
+    if (sysfs_attr(entry.path() / "type").text() != type)
+      continue;
+    if (sysfs_attr(entry.path() / "scope").text() == "Device")
+      continue;
+    result.push_back(entry.path());
+  }
+  std::ranges::sort(result);
+  return result;
+}
+
+monitor::~monitor() {
+#ifdef HAVE_XSS
+  if (_display)
+    XCloseDisplay(_display);
+#endif
+}
+
+void monitor::start(std::function<void(profile const &)> on_change) {
+  _on_change = std::move(on_change);
+  for (auto const &supply : find_supplies("Mains"))
+    _mains.emplace_back(supply / "online");
+  if (_mains.empty())
+    fmt::print(debug, "No mains power supply found, assuming the bar always runs on AC\n");
+
+#ifdef HAVE_XSS
+  // A separate connection because the one GLFW uses belongs to the UI thread.
+  if (glfwGetPlatform() == GLFW_PLATFORM_X11) {
+    _display = XOpenDisplay(nullptr);
+    int event_base, error_base;
+    if (_display && !XScreenSaverQueryExtension(_display, &event_base, &error_base)) {
+      XCloseDisplay(_display);
+      _display = nullptr;
+    }
+  }
+#endif
+
+  uv_timer_init(uv_default_loop(), &_timer);
+  _timer.data = this;
+  auto interval = std::chrono::duration_cast<std::chrono::milliseconds>(config::power_poll_interval).count();
+  uv_timer_start(&_timer, &_on_timer, interval, interval);
+  uv_unref((uv_handle_t *)&_timer);
+
+  _on_battery = _read_on_battery();
+  _idle = _read_idle();
+  _current = (_on_battery ? config::battery_profile : config::ac_profile) * (_idle ? config::idle_profile : profile{});
+  _on_change(_current);
+}
+
+void monitor::_on_timer(uv_timer_t *timer) { ((monitor *)timer->data)->_poll(); }
+
+void monitor::_poll() {
+  bool on_battery = _read_on_battery();
+  bool idle = _read_idle();
+
+  if (on_battery != _on_battery)
+    fmt::print(info, "Running on {}\n", on_battery ? "battery" : "AC");
+  _on_battery = on_battery;
+  _idle = idle;
+
+  auto next = (_on_battery ? config::battery_profile : config::ac_profile) * (_idle ? config::idle_profile : profile{});
+  if (next != _current) {
+    _current = next;
+    _on_change(_current);
+  }
+}
+
+bool monitor::_read_on_battery() {
+  if (_mains.empty())
+    return false;
+  // Any one online supply means we are on AC.
+  for (auto &online : _mains)
+    if (online.number() == 1)
+      return false;
+  return true;
+}
+
+bool monitor::_read_idle() const {
+#ifdef HAVE_XSS
+  if (_display) {
+    XScreenSaverInfo info;
+    if (XScreenSaverQueryInfo(_display, DefaultRootWindow(_display), &info))
+      return std::chrono::milliseconds(info.idle) >= config::idle_after;
+  }
+#endif
+  return false;
+}
+
+} // namespace power
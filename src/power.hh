@@ -0,0 +1,77 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include <uv.h>
+
+#include "sysfs_attr.hh"
+#include "util.hh"
+
+namespace power {
+
+// How much the bar should slow itself down, all of these are factors applied on
+// top of the values in the config.
+struct profile {
+  // Multiplies config::max_fps.
+  double frame_rate = 1;
+  // Multiplies how often the bar is redrawn to animate blocks, that is divides
+  // config::animation_interval.
+  double animation_rate = 1;
+  // Multiplies every block's update interval.
+  double update_interval = 1;
+
+  profile operator*(profile const &other) const {
+    return {frame_rate * other.frame_rate, animation_rate * other.animation_rate,
+            update_interval * other.update_interval};
+  }
+  bool operator==(profile const &) const = default;
+};
+
+// Power supplies in /sys/class/power_supply whose type attribute is the given
+// one ("Battery", "Mains", ...). Supplies of peripherals (wireless mice and the
+// like) are skipped.
+std::vector<std::filesystem::path> find_supplies(std::string_view type);
+
+// Watches whether the machine is running on AC or battery and, if supported,
+// whether the user is idle and reports the profile that should currently be used.
+//
+// Power supply attributes can't be watched with inotify so they are polled,
+// reading one file per supply every few seconds is cheap enough.
+class monitor {
+  // The online attribute of every mains supply.
+  std::vector<sysfs_attr> _mains;
+  uv_timer_t _timer;
+  std::function<void(profile const &)> _on_change;
+  profile _current;
+  bool _on_battery = false;
+  bool _idle = false;
+
+#ifdef HAVE_XSS
+  struct _XDisplay *_display = nullptr;
+#endif
+
+  static void _on_timer(uv_timer_t *);
+  void _poll();
+  bool _read_on_battery();
+  bool _read_idle() const;
+
+public:
+  monitor() = default;
+  ~monitor();
+
+  BAR_NON_COPYABLE(monitor);
+  BAR_NON_MOVEABLE(monitor);
+
+  // Must be called from the loop thread, the callback is called there too
+  // (right away with the initial profile).
+  void start(std::function<void(profile const &)> on_change);
+
+  bool on_battery() const { return _on_battery; }
+  bool idle() const { return _idle; }
+};
+
+} // namespace power
@@ -0,0 +1,30 @@
+#include <cerrno>
+#include <fcntl.h>
+#include <system_error>
+#include <unistd.h>
+
+#include "proc_file.hh"
+
+proc_file::proc_file(std::filesystem::path const &path) : _path(path), _buffer(4096) {
+  _fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (_fd < 0)
+    throw std::system_error(errno, std::generic_category(), "Opening " + _path);
+}
+
+proc_file::~proc_file() { close(_fd); }
+
+std::string_view proc_file::read() {
+  while (true) {
+    ssize_t n = pread(_fd, _buffer.data(), _buffer.size(), 0);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      throw std::system_error(errno, std::generic_category(), "Reading " + _path);
+    }
+
+    // A full buffer may have cut the file short, read it again with more room.
+    if ((std::size_t)n < _buffer.size())
+      return std::string_view(_buffer.data(), n);
+    _buffer.resize(_buffer.size() * 2);
+  }
+}
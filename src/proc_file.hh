@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "digits.hh"
+#include "util.hh"
+
+// A file generated by the kernel (/proc/stat, /proc/meminfo...) that is
+// sampled over and over.
+//
+// The file is opened once and every read() re-reads it from the start with a
+// single pread into a buffer that only ever grows, so once the buffer is large
+// enough reading it doesn't allocate. The kernel generates the whole content
+// for a read from offset zero, which makes each read a consistent sample.
+//
+// Errors are thrown as std::system_error.
+class proc_file {
+  int _fd = -1;
+  std::string _path;
+  std::vector<char> _buffer;
+
+public:
+  explicit proc_file(std::filesystem::path const &path);
+  ~proc_file();
+
+  BAR_NON_COPYABLE(proc_file);
+  BAR_NON_MOVEABLE(proc_file);
+
+  // The whole content of the file, valid until the next call.
+  std::string_view read();
+};
+
+// Reads the text of a proc_file line by line, without allocating and without
+// looking at the locale like iostreams do.
+class proc_scanner {
+  char const *_it;
+  char const *_end;
+
+public:
+  explicit proc_scanner(std::string_view text) : _it(text.data()), _end(text.data() + text.size()) {}
+
+  bool done() const { return _it == _end; }
+
+  // Skips over prefix if the text continues with it.
+  bool consume(std::string_view prefix) {
+    if ((std::size_t)(_end - _it) < prefix.size() || std::string_view(_it, prefix.size()) != prefix)
+      return false;
+    _it += prefix.size();
+    return true;
+  }
+
+  // Skips to the next space or tab on the current line.
+  void skip_word() {
+    while (_it != _end && *_it != ' ' && *_it != '\t' && *_it != '\n')
+      ++_it;
+  }
+
+  // Skips blanks and returns the text up to delimiter, which is skipped too.
+  // Stops at the end of the line if the delimiter isn't on it.
+  std::string_view take_until(char delimiter) {
+    while (_it != _end && (*_it == ' ' || *_it == '\t'))
+      ++_it;
+    auto start = _it;
+    while (_it != _end && *_it != delimiter && *_it != '\n')
+      ++_it;
+    std::string_view taken(start, _it - start);
+    if (_it != _end && *_it == delimiter)
+      ++_it;
+    return taken;
+  }
+
+  // Parses the next decimal number on the current line, zero if there is none.
+  std::uint64_t number() {
+    std::uint64_t value = 0;
+    numbers({&value, 1});
+    return value;
+  }
+
+  // Parses the next numbers on the current line into out, see digits::parse().
+  // Returns how many there were, the rest of out is left alone.
+  std::size_t numbers(std::span<std::uint64_t> out) { return digits::parse(_it, _end, out); }
+
+  // Moves to the start of the next line.
+  void next_line() {
+    while (_it != _end && *_it++ != '\n')
+      ;
+  }
+};
@@ -0,0 +1,122 @@
+#include "samplers.hh"
+
+#include "config.hh"
+#include "proc_file.hh"
+
+namespace samplers {
+
+std::chrono::steady_clock::duration default_max_age() { return config::sample_max_age; }
+
+namespace {
+
+// The first line sums up all CPUs ("cpu  ..."), one line per CPU that is
+// online follows ("cpu0 ..."), then come lines we don't care about. Older
+// kernels have fewer columns, the missing ones stay zero.
+class stat_source final : public source<cpu_times> {
+  proc_file _file{"/proc/stat"};
+
+  void read(cpu_times &all) override {
+    proc_scanner scan(_file.read());
+
+    std::uint64_t fields[10] = {};
+    scan.skip_word();
+    scan.numbers(fields);
+    auto &t = all.total;
+    t.user = fields[0];
+    t.nice = fields[1];
+    t.system = fields[2];
+    t.idle = fields[3];
+    t.iowait = fields[4];
+    t.irq = fields[5];
+    t.softirq = fields[6];
+    t.steal = fields[7];
+    t.guest = fields[8];
+    t.guest_nice = fields[9];
+    scan.next_line();
+
+    all.ids.clear();
+    all.busy.clear();
+    all.notbusy.clear();
+    while (scan.consume("cpu")) {
+      std::ranges::fill(fields, 0);
+      all.ids.push_back(scan.number());
+      scan.numbers(fields);
+      scan.next_line();
+      // user nice system idle iowait irq softirq steal guest guest_nice
+      all.busy.push_back(fields[0] + fields[1] + fields[2] + fields[5] + fields[6] + fields[7] + fields[8] + fields[9]);
+      all.notbusy.push_back(fields[3] + fields[4]);
+    }
+  }
+};
+
+// Lines look like "MemTotal:       16318480 kB", both we need come first.
+class meminfo_source final : public source<memory_info> {
+  proc_file _file{"/proc/meminfo"};
+
+  void read(memory_info &info) override {
+    proc_scanner scan(_file.read());
+
+    info = {};
+    bool found_total = false, found_available = false;
+    while (!scan.done() && !(found_total && found_available)) {
+      if (scan.consume("MemTotal:")) {
+        info.total = scan.number();
+        found_total = true;
+      } else if (scan.consume("MemAvailable:")) {
+        info.available = scan.number();
+        found_available = true;
+      }
+      scan.next_line();
+    }
+  }
+};
+
+// Two header lines, then one line per interface: "  eth0: rx_bytes rx_packets
+// ... (8 receive columns) tx_bytes ...".
+class net_dev_source final : public source<interface_counters> {
+  proc_file _file{"/proc/net/dev"};
+
+  void read(interface_counters &counters) override {
+    proc_scanner scan(_file.read());
+    scan.next_line();
+    scan.next_line();
+
+    // Entries are overwritten in place so that their names keep their storage.
+    size_t count = 0;
+    while (!scan.done()) {
+      auto name = scan.take_until(':');
+      std::uint64_t fields[9] = {};
+      scan.numbers(fields);
+      scan.next_line();
+      if (name.empty())
+        continue;
+
+      if (count == counters.interfaces.size())
+        counters.interfaces.emplace_back();
+      auto &interface = counters.interfaces[count++];
+      interface.name.assign(name);
+      interface.rx_bytes = fields[0];
+      interface.tx_bytes = fields[8];
+    }
+    counters.interfaces.resize(count);
+  }
+};
+
+} // namespace
+
+source<cpu_times> &proc_stat() {
+  static stat_source source;
+  return source;
+}
+
+source<memory_info> &proc_meminfo() {
+  static meminfo_source source;
+  return source;
+}
+
+source<interface_counters> &proc_net_dev() {
+  static net_dev_source source;
+  return source;
+}
+
+} // namespace samplers
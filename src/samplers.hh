@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "util.hh"
+
+// Data from /proc that more than one block may want, two CpuBlocks with
+// different views, the memory usage and a tooltip showing it in detail...
+//
+// Every source is read by whichever of its users first asks for a sample
+// fresher than the last one, the sample is then shared as an immutable
+// snapshot with everyone else who asks before it is too old. Blocks updated in
+// the same tick of the update scheduler get the same sample, so adding views of
+// the same data doesn't read or parse anything more.
+//
+// Samples are recycled once nobody holds on to them anymore, after the first
+// few reads sampling doesn't allocate.
+namespace samplers {
+
+// How old a shared sample may be by default, config::sample_max_age.
+std::chrono::steady_clock::duration default_max_age();
+
+template <class T> struct sample {
+  std::chrono::steady_clock::time_point taken{};
+  T value{};
+};
+
+template <class T> class source {
+  std::mutex _mutex;
+  std::shared_ptr<sample<T>> _latest;
+  // Every sample ever taken, those only the pool holds are reused.
+  std::vector<std::shared_ptr<sample<T>>> _pool;
+
+  // Overwrites everything in value, which holds an older sample.
+  virtual void read(T &value) = 0;
+
+public:
+  source() = default;
+  virtual ~source() = default;
+
+  BAR_NON_COPYABLE(source);
+  BAR_NON_MOVEABLE(source);
+
+  // The latest sample if it was taken at most max_age ago, otherwise a new one.
+  // Can be called from any thread, users asking while the source is being read
+  // wait for that sample. Errors reading the source are thrown to the one that
+  // read it.
+  std::shared_ptr<sample<T> const> get(std::chrono::steady_clock::duration max_age = default_max_age()) {
+    std::lock_guard lock(_mutex);
+
+    auto now = std::chrono::steady_clock::now();
+    if (_latest && now - _latest->taken <= max_age)
+      return _latest;
+
+    // Copies are only handed out under the lock, a count of one can't go up
+    // behind our back. use_count() is a relaxed load, the fence orders the
+    // last user's reads of the sample before our writes to it.
+    auto it = std::ranges::find_if(_pool, [](auto const &s) { return s.use_count() == 1; });
+    if (it == _pool.end())
+      it = _pool.insert(_pool.end(), std::make_shared<sample<T>>());
+    else
+      std::atomic_thread_fence(std::memory_order_acquire);
+    auto &fresh = **it;
+    read(fresh.value);
+    fresh.taken = now;
+    _latest = *it;
+    return _latest;
+  }
+};
+
+// /proc/stat, in clock ticks.
+struct cpu_times {
+  struct times {
+    long user;
+    long nice;
+    long system;
+
+    long idle;
+    long iowait;
+
+    long irq;
+    long softirq;
+
+    long steal;
+    long guest;
+    long guest_nice;
+
+    long busy() const { return user + nice + system + irq + softirq + steal + guest + guest_nice; }
+    long notbusy() const { return idle + iowait; }
+    long total() const { return busy() + notbusy(); }
+
+    times operator-(const times &other) const {
+      times result;
+
+      result.user = user - other.user;
+      result.nice = nice - other.nice;
+      result.system = system - other.system;
+      result.idle = idle - other.idle;
+      result.iowait = iowait - other.iowait;
+      result.irq = irq - other.irq;
+      result.softirq = softirq - other.softirq;
+      result.steal = steal - other.steal;
+      result.guest = guest - other.guest;
+      result.guest_nice = guest_nice - other.guest_nice;
+
+      return result;
+    }
+  };
+
+  times total;
+  // The numbers of the cores that are online, in the order of /proc/stat.
+  std::vector<std::uint32_t> ids;
+  // Only what the usage of a core needs, each in its own array so that the
+  // per core loops are over plain arrays which the compiler vectorizes.
+  std::vector<long> busy, notbusy;
+
+  // Writes this - other into result, reusing its storage. When a core went
+  // on- or offline in between the cores don't line up, they are all shown as
+  // idle for that one update.
+  void difference(cpu_times const &other, cpu_times &result) const {
+    result.total = total - other.total;
+    result.ids = ids;
+    auto cores = busy.size();
+    result.busy.resize(cores);
+    result.notbusy.resize(cores);
+    if (ids != other.ids) {
+      std::ranges::fill(result.busy, 0);
+      std::ranges::fill(result.notbusy, 0);
+      return;
+    }
+    for (size_t i = 0; i < cores; ++i)
+      result.busy[i] = busy[i] - other.busy[i];
+    for (size_t i = 0; i < cores; ++i)
+      result.notbusy[i] = notbusy[i] - other.notbusy[i];
+  }
+};
+
+// /proc/meminfo, in KiB.
+struct memory_info {
+  std::uint64_t total = 0;
+  std::uint64_t available = 0;
+};
+
+// /proc/net/dev, the byte counters of every interface.
+struct interface_counters {
+  struct interface {
+    std::string name;
+    std::uint64_t rx_bytes = 0;
+    std::uint64_t tx_bytes = 0;
+  };
+  std::vector<interface> interfaces;
+};
+
+// The sources, named after the files they read.
+source<cpu_times> &proc_stat();
+source<memory_info> &proc_meminfo();
+source<interface_counters> &proc_net_dev();
+
+} // namespace samplers
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+#include "util.hh"
+
+// Hands values from the thread that updates a block to the thread that draws it
+// without either of them ever waiting for the other.
+//
+// Triple buffered: the writer fills its private back buffer and publishes it by
+// swapping it with the shared middle one, the reader swaps the middle buffer
+// with its private front buffer whenever something new was published. The only
+// synchronization is the atomic exchange of the middle buffer's index.
+//
+// There must be only one writer and one reader thread at a time. The reader
+// side is const (through mutable) so that it can be used from draw_tooltip.
+template <typename T> class snapshot {
+  static constexpr std::uint8_t index_mask = 0b011;
+  // Set in _middle when it holds a value the reader hasn't picked up yet.
+  static constexpr std::uint8_t fresh = 0b100;
+
+  mutable std::array<T, 3> _buffers{};
+  mutable std::atomic<std::uint8_t> _middle{1};
+  std::uint8_t _back = 0;
+  mutable std::uint8_t _front = 2;
+
+public:
+  snapshot() = default;
+  explicit snapshot(T const &initial) : _buffers{initial, initial, initial} {}
+
+  BAR_NON_COPYABLE(snapshot);
+  BAR_NON_MOVEABLE(snapshot);
+
+  // Writer side.
+
+  // The buffer that will be published next. It holds whatever was published two
+  // publications ago, so it has to be assigned completely.
+  T &back() { return _buffers[_back]; }
+  void publish() { _back = _middle.exchange(_back | fresh, std::memory_order_acq_rel) & index_mask; }
+  void publish(T value) {
+    back() = std::move(value);
+    publish();
+  }
+
+  // Reader side.
+
+  // The latest published value, or the value the constructor was given if
+  // nothing was published yet. The reference stays valid until the next call
+  // to read() from the reader thread.
+  T const &read() const {
+    if (_middle.load(std::memory_order_relaxed) & fresh)
+      _front = _middle.exchange(_front, std::memory_order_acq_rel) & index_mask;
+    return _buffers[_front];
+  }
+};
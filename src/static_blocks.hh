@@ -0,0 +1,178 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <tuple>
+#include <utility>
+
+#include "block.hh"
+#include "bufdraw.hh"
+#include "layout.hh"
+#include "snapshot.hh"
+
+namespace _private {
+
+// Lets non-movable blocks be constructed in place from a tuple of arguments.
+template <typename B> struct static_block_slot {
+  B block;
+
+  template <typename... Args>
+  static_block_slot(std::tuple<Args...> args) : block(std::make_from_tuple<B>(std::move(args))) {}
+};
+
+} // namespace _private
+
+// A group of blocks whose types are fixed at compile time.
+//
+// The blocks are stored contiguously in a tuple and called through qualified
+// (non-virtual) calls, so the whole group costs a single virtual dispatch per
+// frame and the compiler is free to inline the blocks' draw paths.
+//
+// Each block is constructed from a tuple of its constructor arguments:
+//
+//   bar.add_right<static_blocks<ClockBlock, MemoryBlock>>(
+//       std::tuple{}, std::tuple{MemoryBlock::Config{.prefix = "MEM "}});
+template <std::derived_from<Block>... Bs> class static_blocks final : public Block {
+  using layout = bar_layout<Block *>;
+  using pos_t = ui::draw::pos_t;
+
+  std::tuple<_private::static_block_slot<Bs>...> _blocks;
+
+  // Position and width of each block in the last frame, nullopt if it was skipped.
+  std::array<std::optional<std::pair<pos_t, pos_t>>, sizeof...(Bs)> _extents;
+  std::optional<size_t> _hovered;
+  // _extents as of the last frame for click() and scroll(), which are called from the loop thread.
+  snapshot<decltype(_extents)> _shared_extents;
+
+  template <size_t I> auto &_get() { return std::get<I>(_blocks).block; }
+  template <size_t I> auto const &_get() const { return std::get<I>(_blocks).block; }
+
+  template <typename F> void _for_each(F &&f) {
+    [&]<size_t... Is>(std::index_sequence<Is...>) { (f.template operator()<Is>(), ...); }
+    (std::index_sequence_for<Bs...>());
+  }
+
+  template <size_t I, typename R> R _visit_hovered(auto &&f, R fallback) const {
+    if constexpr (I == sizeof...(Bs))
+      return fallback;
+    else if (_hovered == I)
+      return f(_get<I>(), _extents[I]->second);
+    else
+      return _visit_hovered<I + 1>(f, fallback);
+  }
+
+  // Calls f with the block under x and x relative to it, if there is one.
+  template <size_t I = 0> void _visit_at(pos_t x, auto &&f) {
+    if constexpr (I < sizeof...(Bs)) {
+      using B = std::tuple_element_t<I, std::tuple<Bs...>>;
+      auto const &extent = _shared_extents.read()[I];
+      if (extent && extent->first <= x && x < extent->first + extent->second)
+        f.template operator()<B>(_get<I>(), x - extent->first);
+      else
+        _visit_at<I + 1>(x, f);
+    }
+  }
+
+public:
+  template <typename... Args>
+    requires(sizeof...(Args) == sizeof...(Bs))
+  static_blocks(Args &&...args) : _blocks(std::forward<Args>(args)...) {}
+
+  void setup() override {
+    _for_each([this]<size_t I>() {
+      using B = std::tuple_element_t<I, std::tuple<Bs...>>;
+      _get<I>().B::setup();
+    });
+  }
+
+  bool skip() override {
+    bool all = true;
+    _for_each([this, &all]<size_t I>() {
+      using B = std::tuple_element_t<I, std::tuple<Bs...>>;
+      all = all && _get<I>().B::skip();
+    });
+    return all;
+  }
+
+  void for_each_part(std::function<void(Block &)> const &f) override {
+    _for_each([this, &f]<size_t I>() { f(_get<I>()); });
+  }
+
+  void animate(Interval delta) override {
+    _for_each([this, delta]<size_t I>() {
+      using B = std::tuple_element_t<I, std::tuple<Bs...>>;
+      _get<I>().B::animate(delta);
+    });
+  }
+
+  size_t draw(ui::draw &draw, std::chrono::duration<double> delta, size_t x, bool right) override {
+    pos_t offset = 0;
+
+    _for_each([&]<size_t I>() {
+      using B = std::tuple_element_t<I, std::tuple<Bs...>>;
+      auto &block = _get<I>();
+
+      if (block.B::skip()) {
+        _extents[I].reset();
+        return;
+      }
+
+      if (offset != 0) {
+        offset += layout::separator_margin;
+        draw.frect(offset, 3, layout::separator_width, draw.height() - 6, 0xD3D3D3);
+        offset += layout::separator_width + layout::separator_margin;
+      }
+
+      // The blocks are drawn one after the other, each one's offset is known
+      // before it is drawn.
+      OffsetDraw shifted(draw, offset);
+      // SimpleBlock's own draw is the one that draws the placeholder and marks
+      // stale blocks, the qualified call still isn't virtual.
+      pos_t width;
+      if constexpr (std::derived_from<B, SimpleBlock>)
+        width = block.B::SimpleBlock::draw(shifted, delta, x + offset, right);
+      else
+        width = block.B::draw(shifted, delta, x + offset, right);
+
+      _extents[I] = {offset, width};
+      offset += width;
+    });
+
+    _shared_extents.publish(_extents);
+    return offset;
+  }
+
+  bool hover(pos_t x) override {
+    std::optional<size_t> hovered;
+    for (size_t i = 0; i < _extents.size(); ++i)
+      if (_extents[i] && _extents[i]->first <= x && x < _extents[i]->first + _extents[i]->second)
+        hovered = i;
+
+    bool changed = hovered != _hovered;
+    _hovered = hovered;
+    return changed;
+  }
+
+  void click(pos_t x, int button) override {
+    _visit_at(x, [button]<typename B>(B &block, pos_t x) { block.B::click(x, button); });
+  }
+  void scroll(pos_t x, double dx, double dy) override {
+    _visit_at(x, [dx, dy]<typename B>(B &block, pos_t x) { block.B::scroll(x, dx, dy); });
+  }
+
+  bool has_tooltip() const override {
+    return _visit_hovered<0>([](auto const &block, pos_t) { return block.ready() && block.has_tooltip(); }, false);
+  }
+  void draw_tooltip(ui::draw &draw, std::chrono::duration<double> delta, unsigned) const override {
+    _visit_hovered<0>(
+        [&](auto const &block, pos_t width) {
+          block.draw_tooltip(draw, delta, width);
+          return true;
+        },
+        false);
+  }
+};
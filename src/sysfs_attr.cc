@@ -0,0 +1,55 @@
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <utility>
+
+#include "digits.hh"
+#include "sysfs_attr.hh"
+
+sysfs_attr::sysfs_attr(std::filesystem::path const &path) { _fd = open(path.c_str(), O_RDONLY | O_CLOEXEC); }
+
+sysfs_attr::sysfs_attr(sysfs_attr &&other) noexcept : _fd(std::exchange(other._fd, -1)) {}
+
+sysfs_attr &sysfs_attr::operator=(sysfs_attr &&other) noexcept {
+  if (this != &other) {
+    if (_fd >= 0)
+      close(_fd);
+    _fd = std::exchange(other._fd, -1);
+  }
+  return *this;
+}
+
+sysfs_attr::~sysfs_attr() {
+  if (_fd >= 0)
+    close(_fd);
+}
+
+std::optional<std::string_view> sysfs_attr::text() {
+  if (_fd < 0)
+    return std::nullopt;
+
+  ssize_t n;
+  do
+    n = pread(_fd, _buffer.data(), _buffer.size(), 0);
+  while (n < 0 && errno == EINTR);
+  if (n < 0)
+    return std::nullopt;
+
+  std::string_view value(_buffer.data(), n);
+  if (value.ends_with('\n'))
+    value.remove_suffix(1);
+  return value;
+}
+
+std::optional<std::int64_t> sysfs_attr::number() {
+  auto value = text();
+  if (!value)
+    return std::nullopt;
+
+  bool negative = value->starts_with('-');
+  char const *it = value->data() + negative;
+  std::uint64_t magnitude;
+  if (digits::parse(it, value->data() + value->size(), {&magnitude, 1}) == 0)
+    return std::nullopt;
+  return negative ? -(std::int64_t)magnitude : (std::int64_t)magnitude;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+
+// A sysfs attribute that is sampled over and over (a battery's energy_now, an
+// interface's statistics/rx_bytes...).
+//
+// The file is opened once and every read re-reads it with a single pread at
+// offset zero, for which sysfs formats the whole value again, into a buffer
+// that is part of the object. Attributes may be missing and reading them may
+// fail (a battery being unplugged, the carrier of an interface that is down),
+// both give an empty optional instead of an exception.
+class sysfs_attr {
+  int _fd = -1;
+  std::array<char, 128> _buffer{};
+
+public:
+  sysfs_attr() = default;
+  explicit sysfs_attr(std::filesystem::path const &path);
+  sysfs_attr(sysfs_attr &&other) noexcept;
+  sysfs_attr &operator=(sysfs_attr &&other) noexcept;
+  ~sysfs_attr();
+
+  bool exists() const { return _fd >= 0; }
+
+  // The value without its trailing newline, valid until the next read. Values
+  // are cut off after 128 bytes, plenty for numbers and status words.
+  std::optional<std::string_view> text();
+  // The value as a decimal integer, as printed by the kernel's %d, %lu...
+  std::optional<std::int64_t> number();
+};
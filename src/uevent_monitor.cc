@@ -0,0 +1,105 @@
+#include "uevent_monitor.hh"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <linux/netlink.h>
+#include <string_view>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+#include <uv.h>
+
+#include "log.hh"
+
+struct uevent_monitor::watcher {
+  uv_poll_t poll;
+  int fd;
+  std::string subsystem;
+  std::vector<std::string> actions;
+  std::function<void()> on_change;
+  // The largest uevent the kernel sends.
+  std::array<char, 8192> buffer{};
+
+  static void on_readable(uv_poll_t *, int status, int events);
+};
+
+// The poll handle stops watching the socket once it is closed, only then is
+// the socket.
+void uevent_monitor::watcher_deleter::operator()(watcher *w) const {
+  uv_close((uv_handle_t *)&w->poll, [](uv_handle_t *handle) {
+    auto *w = (watcher *)handle->data;
+    close(w->fd);
+    delete w;
+  });
+}
+
+uevent_monitor::~uevent_monitor() = default;
+
+void uevent_monitor::start(std::string subsystem, std::vector<std::string> actions, std::function<void()> on_change) {
+  int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+  // Group 1 gets the events straight from the kernel, udev rebroadcasts them
+  // on group 2 after processing them.
+  sockaddr_nl address{.nl_family = AF_NETLINK, .nl_pad = 0, .nl_pid = 0, .nl_groups = 1};
+  if (fd < 0 || bind(fd, (sockaddr *)&address, sizeof address) < 0) {
+    fmt::print(warn, "Failed to listen to {} uevents, changes will only be noticed late or not at all: {}\n",
+               subsystem, strerror(errno));
+    if (fd >= 0)
+      close(fd);
+    return;
+  }
+
+  auto *w = new watcher{.poll = {},
+                        .fd = fd,
+                        .subsystem = std::move(subsystem),
+                        .actions = std::move(actions),
+                        .on_change = std::move(on_change)};
+  if (int err = uv_poll_init(uv_default_loop(), &w->poll, fd); err < 0) {
+    fmt::print(warn, "Failed to listen to {} uevents: {}\n", w->subsystem, uv_strerror(err));
+    close(fd);
+    delete w;
+    return;
+  }
+  w->poll.data = w;
+  _watcher.reset(w);
+
+  uv_poll_start(&w->poll, UV_READABLE, &watcher::on_readable);
+  uv_unref((uv_handle_t *)&w->poll);
+}
+
+// A uevent is a header ("add@/devices/...") followed by KEY=value pairs, all
+// null terminated.
+void uevent_monitor::watcher::on_readable(uv_poll_t *handle, int status, int) {
+  auto *self = (watcher *)handle->data;
+  if (status < 0)
+    return;
+
+  bool changed = false;
+  while (true) {
+    ssize_t n = recv(self->fd, self->buffer.data(), self->buffer.size(), 0);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      // EAGAIN once drained, ENOBUFS if events were dropped because we fell
+      // behind, which could have been any of them.
+      changed |= errno == ENOBUFS;
+      break;
+    }
+
+    std::string_view action, subsystem;
+    std::string_view message(self->buffer.data(), n);
+    while (!message.empty()) {
+      auto field = message.substr(0, message.find('\0'));
+      message.remove_prefix(std::min(field.size() + 1, message.size()));
+      if (field.starts_with("ACTION="))
+        action = field.substr(7);
+      else if (field.starts_with("SUBSYSTEM="))
+        subsystem = field.substr(10);
+    }
+    changed |= subsystem == self->subsystem && std::ranges::find(self->actions, action) != self->actions.end();
+  }
+
+  if (changed)
+    self->on_change();
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "util.hh"
+
+// Listens to the uevents the kernel broadcasts over netlink when devices come
+// and go or change, for rediscovering or re-reading things found in sysfs only
+// when that could have changed them. on_change is called on the loop thread
+// after uevents of the subsystem with one of the given actions ("add",
+// "remove", "change"...).
+//
+// Without access to the uevent socket (in some containers...) a warning is
+// logged and nothing is ever reported, what was discovered once stays.
+class uevent_monitor {
+  // Lives until libuv is done with the poll handle, which may be after the
+  // monitor is gone.
+  struct watcher;
+  struct watcher_deleter {
+    void operator()(watcher *) const;
+  };
+
+  std::unique_ptr<watcher, watcher_deleter> _watcher;
+
+public:
+  uevent_monitor() = default;
+  ~uevent_monitor();
+
+  BAR_NON_COPYABLE(uevent_monitor);
+  BAR_NON_MOVEABLE(uevent_monitor);
+
+  // Must be called from the loop thread, at most once. So must the destructor
+  // of a started monitor.
+  void start(std::string subsystem, std::vector<std::string> actions, std::function<void()> on_change);
+};
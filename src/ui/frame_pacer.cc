@@ -0,0 +1,41 @@
+#include "frame_pacer.hh"
+
+#include <wayland-client.h>
+
+namespace ui {
+
+void frame_pacer::attach(GLFWwindow *window) {
+  reset();
+  if (glfwGetPlatform() == GLFW_PLATFORM_WAYLAND)
+    _surface = glfwGetWaylandWindow(window);
+  else
+    _surface = nullptr;
+}
+
+void frame_pacer::_on_frame_done(void *data, wl_callback *callback, uint32_t) {
+  auto *self = (frame_pacer *)data;
+  if (self->_callback.compare_exchange_strong(callback, nullptr, std::memory_order_acq_rel)) {
+    wl_callback_destroy(callback);
+    self->_presented.store(true, std::memory_order_relaxed);
+  }
+}
+
+void frame_pacer::frame_requested() {
+  static wl_callback_listener const listener = {.done = _on_frame_done};
+
+  if (!_surface || !can_present())
+    return;
+
+  // The callback can't be done before the buffer swap commits it.
+  auto *callback = wl_surface_frame(_surface);
+  _requested_at = std::chrono::steady_clock::now();
+  wl_callback_add_listener(callback, &listener, this);
+  _callback.store(callback, std::memory_order_release);
+}
+
+void frame_pacer::reset() {
+  if (auto *callback = _callback.exchange(nullptr, std::memory_order_acq_rel))
+    wl_callback_destroy(callback);
+}
+
+} // namespace ui
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "gl.hh"
+
+#include <atomic>
+#include <chrono>
+
+#include "../util.hh"
+
+namespace ui {
+
+// Lets the compositor decide when a window should be redrawn.
+//
+// On Wayland a wl_surface.frame callback is requested together with every
+// buffer swap and further frames are held back until the compositor signals
+// that the previous one was presented. Compositors stop sending these callbacks
+// while the surface is not visible (occluded, on a locked screen, on an output
+// that is powered off...) so this also makes us skip rendering completely in
+// that case.
+//
+// On other platforms the pacer is inert and can_present() is always true.
+//
+// Frames are requested from the thread that draws them while the callbacks
+// arrive on the thread that dispatches the display's events, whichever of
+// frame callback and reset() takes the callback first destroys it.
+class frame_pacer {
+  struct wl_surface *_surface = nullptr;
+  std::atomic<struct wl_callback *> _callback = nullptr;
+  std::atomic<bool> _presented = false;
+  std::chrono::steady_clock::time_point _requested_at;
+
+  static void _on_frame_done(void *data, struct wl_callback *callback, uint32_t time);
+
+public:
+  frame_pacer() = default;
+  ~frame_pacer() { reset(); }
+
+  BAR_NON_COPYABLE(frame_pacer);
+  BAR_NON_MOVEABLE(frame_pacer);
+
+  void attach(GLFWwindow *window);
+
+  bool active() const { return _surface != nullptr; }
+  // Whether the compositor is ready to accept another frame.
+  bool can_present() const { return _callback.load(std::memory_order_acquire) == nullptr; }
+  // When the pending frame callback was requested, only meaningful while
+  // can_present() is false.
+  std::chrono::steady_clock::time_point requested_at() const { return _requested_at; }
+
+  // Whether a frame callback arrived since the last call, for the thread that
+  // dispatches them to wake up the one that draws.
+  bool take_presented() { return _presented.exchange(false, std::memory_order_relaxed); }
+
+  // Must be called right before the buffers are swapped so that the frame
+  // request is committed together with the new buffer.
+  void frame_requested();
+
+  void reset();
+};
+
+} // namespace ui
@@ -30,6 +30,7 @@
 #include <pango/pangocairo.h>
 
 #include "../log.hh"
+#include "../perf.hh"
 #include "../util.hh"
 #include "draw.hh"
 #include "gl.hh"
@@ -196,8 +197,11 @@ TextRenderer::CachedText TextRenderer::_text_full(PreparedText const &prep) {
 
 TextRenderer::Result TextRenderer::render(std::string_view text) {
   auto *cached = _text_cache.get(text);
-  if (cached == NULL)
+  if (cached == NULL) {
+    perf::global().text_cache_misses.fetch_add(1, std::memory_order_relaxed);
     cached = &_text_cache.insert(std::string(text), _text_full(_text_prepare(text)));
+  } else
+    perf::global().text_cache_hits.fetch_add(1, std::memory_order_relaxed);
 
   // if (std::abs((int)cached->logical_size.x - (int)cached->ink_size.x) > 10)
   //   debug << "differs on " << std::quoted(text) << ": " << cached->logical_size << ' ' << cached->ink_size << '\n';
@@ -214,8 +218,11 @@ TextRenderer::Result TextRenderer::render(std::string_view text) {
 
 uvec2 TextRenderer::size(std::string_view text) {
   auto *cached = _text_cache.get(text);
-  if (cached == NULL)
+  if (cached == NULL) {
+    perf::global().text_cache_misses.fetch_add(1, std::memory_order_relaxed);
     cached = &_text_cache.insert(std::string(text), _text_full(_text_prepare(text)));
+  } else
+    perf::global().text_cache_hits.fetch_add(1, std::memory_order_relaxed);
 
   return cached->logical_size;
 }
@@ -8,6 +8,7 @@ struct uvec2 {
   std::uint32_t x, y;
 
   bool is_zero() { return x == 0 && y == 0; }
+  bool operator==(uvec2 const &) const = default;
 
   friend std::ostream &operator<<(std::ostream &os, uvec2 const &self) {
     return os << "[" << self.x << ", " << self.y << "]";
@@ -0,0 +1,86 @@
+#include "visibility.hh"
+
+#include <chrono>
+#include <utility>
+
+#include <X11/Xlib.h>
+#include <X11/extensions/dpms.h>
+
+#include "../config.hh"
+#include "../log.hh"
+
+namespace ui {
+
+x11_visibility_monitor::~x11_visibility_monitor() {
+  if (_display)
+    XCloseDisplay(_display);
+}
+
+void x11_visibility_monitor::start(GLFWwindow *window, std::function<void(hidden_reason, bool)> on_change) {
+  if (glfwGetPlatform() != GLFW_PLATFORM_X11)
+    return;
+
+  _display = XOpenDisplay(nullptr);
+  if (!_display) {
+    fmt::print(warn, "Failed to open a second X11 connection, visibility of the bar won't be tracked\n");
+    return;
+  }
+
+  _on_change = std::move(on_change);
+  _window = glfwGetX11Window(window);
+
+  // Other clients can select these events on our window too, GLFW's event mask
+  // is unaffected.
+  XSelectInput(_display, _window, VisibilityChangeMask | StructureNotifyMask);
+  XFlush(_display);
+
+  auto loop = uv_default_loop();
+  uv_poll_init(loop, &_poll, ConnectionNumber(_display));
+  _poll.data = this;
+  uv_poll_start(&_poll, UV_READABLE, &_on_readable);
+  uv_unref((uv_handle_t *)&_poll);
+
+  // DPMS has no events, its state has to be polled.
+  int event_base, error_base;
+  if (DPMSQueryExtension(_display, &event_base, &error_base) && DPMSCapable(_display)) {
+    uv_timer_init(loop, &_dpms_timer);
+    _dpms_timer.data = this;
+    auto interval = std::chrono::duration_cast<std::chrono::milliseconds>(config::x11::dpms_poll_interval).count();
+    uv_timer_start(&_dpms_timer, &_on_dpms_timer, interval, interval);
+    uv_unref((uv_handle_t *)&_dpms_timer);
+  }
+}
+
+void x11_visibility_monitor::_on_readable(uv_poll_t *handle, int status, int) {
+  auto *self = (x11_visibility_monitor *)handle->data;
+  if (status < 0)
+    return;
+
+  while (XPending(self->_display)) {
+    XEvent event;
+    XNextEvent(self->_display, &event);
+
+    switch (event.type) {
+    case VisibilityNotify:
+      self->_on_change(hidden_reason::obscured, event.xvisibility.state == VisibilityFullyObscured);
+      break;
+    case UnmapNotify:
+      self->_on_change(hidden_reason::unmapped, true);
+      break;
+    case MapNotify:
+      self->_on_change(hidden_reason::unmapped, false);
+      break;
+    }
+  }
+}
+
+void x11_visibility_monitor::_on_dpms_timer(uv_timer_t *timer) {
+  auto *self = (x11_visibility_monitor *)timer->data;
+
+  CARD16 level;
+  BOOL enabled;
+  if (DPMSInfo(self->_display, &level, &enabled))
+    self->_on_change(hidden_reason::output_off, enabled && level != DPMSModeOn);
+}
+
+} // namespace ui
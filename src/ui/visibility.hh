@@ -0,0 +1,57 @@
+#pragma once
+
+#include <functional>
+
+#include <uv.h>
+
+#include "gl.hh"
+
+#include "../util.hh"
+
+namespace ui {
+
+// Reasons for the bar not being visible, the bar counts as hidden as long as
+// any one of them applies.
+enum class hidden_reason : unsigned {
+  // Covered by another window (X11 VisibilityNotify).
+  obscured = 1 << 0,
+  // The window was unmapped.
+  unmapped = 1 << 1,
+  // The window was iconified (minimized).
+  iconified = 1 << 2,
+  // The monitors were turned off through DPMS.
+  output_off = 1 << 3,
+  // The compositor stopped sending frame callbacks, which Wayland compositors do
+  // for surfaces that can't be seen: covered, on a locked screen or on an output
+  // that is powered off.
+  no_frame_callbacks = 1 << 4,
+};
+
+// Watches the bar window for events that GLFW doesn't tell us about, through a
+// separate X11 connection that lives on the loop thread (GLFW's belongs to the
+// UI thread). Does nothing on other platforms.
+//
+// Note that under a compositing manager windows are never reported as obscured
+// since everything is drawn offscreen.
+class x11_visibility_monitor {
+  struct _XDisplay *_display = nullptr;
+  unsigned long _window = 0;
+  uv_poll_t _poll;
+  uv_timer_t _dpms_timer;
+  std::function<void(hidden_reason, bool)> _on_change;
+
+  static void _on_readable(uv_poll_t *, int status, int events);
+  static void _on_dpms_timer(uv_timer_t *);
+
+public:
+  x11_visibility_monitor() = default;
+  ~x11_visibility_monitor();
+
+  BAR_NON_COPYABLE(x11_visibility_monitor);
+  BAR_NON_MOVEABLE(x11_visibility_monitor);
+
+  // Must be called from the loop thread, so is the callback.
+  void start(GLFWwindow *window, std::function<void(hidden_reason, bool)> on_change);
+};
+
+} // namespace ui
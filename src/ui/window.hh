@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <cmath>
 #include <memory>
 #include <numbers>
@@ -61,11 +62,20 @@ class gdraw final : public draw {
   int _width, _height;
   int _available_width, _available_height;
   float _xscale, _yscale;
+  float _content_xscale, _content_yscale;
   int _fixed_rendering_height = -1;
   TextRenderer _texter;
-
+  // The framebuffer size and content scale reported by GLFW on the thread
+  // handling events, applied by sync() on the thread the context is current on.
+  std::atomic<int> _pending_width = 0, _pending_height = 0;
+  std::atomic<float> _pending_xscale = 1, _pending_yscale = 1;
+  std::atomic<bool> _resized = false;
+
+  // Must be constructed on the thread handling events, with the window's
+  // context current.
   gdraw(GLFWwindow *win) : _window(win) {
     glfwGetFramebufferSize(win, &_width, &_height);
+    glfwGetWindowContentScale(win, &_content_xscale, &_content_yscale);
     _update_projection();
 
     glDisable(GL_DEPTH_TEST);
@@ -76,9 +86,13 @@ class gdraw final : public draw {
     glfwSetWindowUserPointer(win, this);
     glfwSetFramebufferSizeCallback(_window, [](GLFWwindow *window, int width, int height) {
       gdraw *self = ((gdraw *)glfwGetWindowUserPointer(window));
-      self->_width = width;
-      self->_height = height;
-      self->_update_projection();
+      float xscale, yscale;
+      glfwGetWindowContentScale(window, &xscale, &yscale);
+      self->_pending_width.store(width, std::memory_order_relaxed);
+      self->_pending_height.store(height, std::memory_order_relaxed);
+      self->_pending_xscale.store(xscale, std::memory_order_relaxed);
+      self->_pending_yscale.store(yscale, std::memory_order_relaxed);
+      self->_resized.store(true, std::memory_order_release);
     });
   }
 
@@ -88,9 +102,8 @@ class gdraw final : public draw {
   friend class gwindow;
 
   void _update_projection() {
-    int window_width, window_height;
-    glfwGetWindowSize(_window, &window_width, &window_height);
-    glfwGetWindowContentScale(_window, &_xscale, &_yscale);
+    _xscale = _content_xscale;
+    _yscale = _content_yscale;
 
     if (_fixed_rendering_height != -1) {
       _available_height = _fixed_rendering_height;
@@ -114,7 +127,6 @@ class gdraw final : public draw {
     }
     fmt::print(debug, "\n");
     fmt::print(debug, "  Framebuffer size changed to {}x{}\n", _width, _height);
-    fmt::print(debug, "  Window size is {}x{}\n", window_width, window_height);
     fmt::print(debug, "  Content scale is x:{} y:{}\n", _xscale, _yscale);
     fmt::print(debug, "  Scaled size is {}x{}\n", _available_width, _available_height);
 
@@ -122,6 +134,17 @@ class gdraw final : public draw {
   }
 
 public:
+  // Picks up a framebuffer size change, must be called before drawing.
+  void sync() {
+    if (!_resized.exchange(false, std::memory_order_acquire))
+      return;
+    _width = _pending_width.load(std::memory_order_relaxed);
+    _height = _pending_height.load(std::memory_order_relaxed);
+    _content_xscale = _pending_xscale.load(std::memory_order_relaxed);
+    _content_yscale = _pending_yscale.load(std::memory_order_relaxed);
+    _update_projection();
+  }
+
   void set_fixed_rendering_height(int height) {
     _fixed_rendering_height = height;
     _update_projection();
@@ -136,8 +159,7 @@ public:
   pos_t hcenter() const { return _available_width / 2; }
 
   void line(pos_t x1, pos_t y1, pos_t x2, pos_t y2, color color) {
-    color::rgb rgb = color;
-    glColor3ub(rgb.r, rgb.g, rgb.b);
+    glColor4ub(color.r(), color.g(), color.b(), color.a());
 
     glBegin(GL_LINE);
     glVertex2i(x1, y1);
@@ -146,8 +168,7 @@ public:
   }
 
   void hrect(pos_t x, pos_t y, pos_t w, pos_t h, color color) {
-    color::rgb rgb = color;
-    glColor3ub(rgb.r, rgb.g, rgb.b);
+    glColor4ub(color.r(), color.g(), color.b(), color.a());
 
     glLineWidth(1.15);
     glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -160,8 +181,7 @@ public:
   }
 
   void frect(pos_t x, pos_t y, pos_t w, pos_t h, color color) {
-    color::rgb rgb = color;
-    glColor3ub(rgb.r, rgb.g, rgb.b);
+    glColor4ub(color.r(), color.g(), color.b(), color.a());
 
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     glBegin(GL_POLYGON);
@@ -173,8 +193,7 @@ public:
   }
 
   void fcircle(pos_t x, pos_t y, pos_t d, color color) {
-    color::rgb rgb = color;
-    glColor3ub(rgb.r, rgb.g, rgb.b);
+    glColor4ub(color.r(), color.g(), color.b(), color.a());
 
     constexpr int segments = 100;
     static struct CircleThetas {
@@ -206,14 +225,13 @@ public:
     auto [logical, ink, off, texture] = _texter.render(text);
 
     if (texture) {
-      color::rgb rgb = color;
       ink.x /= text_render_scale(), ink.y /= text_render_scale();
       x += off.x / text_render_scale(), y += off.y / text_render_scale();
 
       // fmt::println("drawing texture {} for {:?} at ({}, {})", texture, text, x, y);
       glActiveTexture(GL_TEXTURE_2D);
       glBindTexture(GL_TEXTURE_2D, texture);
-      glColor3ub(rgb.r, rgb.g, rgb.b);
+      glColor4ub(color.r(), color.g(), color.b(), color.a());
 
       glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
       glBegin(GL_QUADS);
@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <limits>
+
+#include "bar.hh"
+#include "block.hh"
+#include "config.hh"
+#include "update_scheduler.hh"
+
+static auto const blocking_update_deadline =
+    (std::uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(config::blocking_update_deadline).count();
+
+void update_scheduler::configure(std::chrono::milliseconds tick) { _tick = std::max<std::uint64_t>(tick.count(), 1); }
+
+// Rounds to the nearest multiple of the tick, but never below one tick.
+std::uint64_t update_scheduler::_round(std::chrono::milliseconds interval) const {
+  std::uint64_t rounded = std::max<std::uint64_t>((interval.count() + _tick / 2) / _tick, 1) * _tick;
+  if (rounded != (std::uint64_t)interval.count())
+    fmt::print(debug, "Update interval of {}ms rounded to {}ms to fit the {}ms update tick\n", interval.count(),
+               rounded, _tick);
+  return rounded;
+}
+
+void update_scheduler::add(SimpleBlock &block) {
+  auto interval = block.update_interval();
+  if (interval == SimpleBlock::Interval::max())
+    return;
+
+  auto loop = uv_default_loop();
+  if (!_timer_initialized) {
+    uv_timer_init(loop, &_timer);
+    _timer.data = this;
+    // Like the per-block timers this replaces, pending updates shouldn't keep the loop alive.
+    uv_unref((uv_handle_t *)&_timer);
+    _timer_initialized = true;
+  }
+
+  auto now = uv_now(loop);
+  auto &entry = _entries.emplace_back(update_scheduler::entry{
+      .owner = this,
+      .block = &block,
+      .nominal_base = std::chrono::duration_cast<std::chrono::milliseconds>(interval),
+      .nominal_max = std::chrono::duration_cast<std::chrono::milliseconds>(block.max_update_interval()),
+  });
+  entry.async = dynamic_cast<AsyncBlock *>(&block);
+  entry.on_worker = block.update_may_block();
+  _apply_scale(entry, now);
+
+  // The first update isn't done by SimpleBlock::setup, so startup doesn't wait
+  // for one block after another. Blocks that may be updated on a worker thread
+  // get it there right away, concurrently with the rest of startup, the others
+  // on the loop thread as soon as it runs.
+  _first_updates_pending += 1;
+  if (entry.async || entry.on_worker || block.update_may_move())
+    _dispatch(entry, now);
+  else
+    entry.next = now;
+  _arm(now);
+}
+
+void update_scheduler::_apply_scale(entry &entry, std::uint64_t now) {
+  auto scaled = [this, &entry](std::chrono::milliseconds interval) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(interval * _scale * entry.widening);
+  };
+  entry.base_interval = std::max(_round(scaled(entry.nominal_base)), _hidden_interval);
+  entry.max_interval = std::max(entry.base_interval, _round(scaled(entry.nominal_max)));
+  entry.interval = entry.base_interval;
+  entry.next = (now / entry.interval + 1) * entry.interval;
+}
+
+void update_scheduler::scale(double factor) {
+  if (factor == _scale)
+    return;
+  _scale = factor;
+
+  auto now = uv_now(uv_default_loop());
+  for (auto &entry : _entries)
+    _apply_scale(entry, now);
+  _arm(now);
+}
+
+void update_scheduler::reset(SimpleBlock &block) {
+  auto it = std::ranges::find(_entries, &block, &entry::block);
+  if (it == _entries.end() || it->interval == it->base_interval)
+    return;
+
+  auto now = uv_now(uv_default_loop());
+  it->interval = it->base_interval;
+  it->next = std::min(it->next, (now / it->interval + 1) * it->interval);
+  _arm(now);
+}
+
+void update_scheduler::trigger(SimpleBlock &block) {
+  auto it = std::ranges::find(_entries, &block, &entry::block);
+  if (it == _entries.end())
+    return;
+
+  auto now = uv_now(uv_default_loop());
+  it->interval = it->base_interval;
+  it->next = now;
+  it->triggered = it->in_flight;
+  _arm(now);
+}
+
+bool update_scheduler::offload(SimpleBlock &block) {
+  auto it = std::ranges::find(_entries, &block, &entry::block);
+  if (it == _entries.end() || it->async || it->on_worker)
+    return false;
+
+  // Takes effect with the next update, this one is running right now if we
+  // are called from a block's update().
+  it->on_worker = true;
+  return true;
+}
+
+bool update_scheduler::widen(SimpleBlock &block, double max_factor) {
+  auto it = std::ranges::find(_entries, &block, &entry::block);
+  if (it == _entries.end() || it->widening >= max_factor)
+    return false;
+
+  auto now = uv_now(uv_default_loop());
+  it->widening = std::min(it->widening * 2, max_factor);
+  _apply_scale(*it, now);
+  _arm(now);
+  return true;
+}
+
+void update_scheduler::hide(std::chrono::milliseconds interval) {
+  if (hidden())
+    return;
+  _hidden_interval = _round(interval);
+
+  auto now = uv_now(uv_default_loop());
+  for (auto &entry : _entries)
+    _apply_scale(entry, now);
+  _arm(now);
+}
+
+void update_scheduler::show() {
+  if (!hidden())
+    return;
+  _hidden_interval = 0;
+
+  auto now = uv_now(uv_default_loop());
+  for (auto &entry : _entries)
+    _apply_scale(entry, now);
+  // Whatever was sampled while hidden is stale by now, catch up with one
+  // update of every block.
+  _run(now, true);
+  _arm(now);
+}
+
+void update_scheduler::_on_timer(uv_timer_t *timer) {
+  auto *self = (update_scheduler *)timer->data;
+  auto now = uv_now(timer->loop);
+  self->_run(now);
+  self->_arm(now);
+}
+
+void update_scheduler::_run(std::uint64_t now, bool all) {
+  perf::global().update_wakeups.fetch_add(1, std::memory_order_relaxed);
+
+  bool redraw = all;
+  for (auto &entry : _entries) {
+    if (entry.in_flight && !entry.block->stale() && now >= entry.started + blocking_update_deadline) {
+      fmt::print(warn, "Update of {} has been running for over {}ms, showing it as stale\n",
+                 demangled_name(typeid(*entry.block)), blocking_update_deadline);
+      entry.block->_stale.store(true, std::memory_order_relaxed);
+      redraw = true;
+    }
+
+    if (!all && entry.next > now)
+      continue;
+
+    // The first update of a block that may move runs on the thread pool too.
+    if (entry.async || entry.on_worker || entry.in_flight) {
+      // If the previous update is still running this one is simply skipped.
+      if (!entry.in_flight)
+        _dispatch(entry, now);
+      entry.next = (now / entry.interval + 1) * entry.interval;
+      continue;
+    }
+
+    {
+      perf::timing::scope measure(entry.block->perf_stats().update, config::watchdog::update_budget);
+      entry.block->update();
+    }
+    redraw |= _finished(entry, now);
+  }
+
+  // Nothing is drawn while the bar is hidden anyway.
+  if (redraw && !hidden())
+    bar::instance().schedule_redraw();
+}
+
+bool update_scheduler::_finished(entry &entry, std::uint64_t now) {
+  bool redraw = entry.block->needs_redraw();
+  // Whatever it shows now replaces the placeholder.
+  if (!entry.block->_ready.exchange(true, std::memory_order_acq_rel)) {
+    redraw = true;
+    if (--_first_updates_pending == 0)
+      perf::startup_step("first updates done");
+  }
+  if (redraw)
+    entry.interval = entry.base_interval;
+  else
+    entry.interval = std::min(entry.interval * 2, entry.max_interval);
+
+  // Skip grid points that were missed because the loop was busy instead of
+  // trying to catch up on them.
+  entry.next = (now / entry.interval + 1) * entry.interval;
+  return redraw;
+}
+
+void update_scheduler::_dispatch(entry &entry, std::uint64_t now) {
+  entry.in_flight = true;
+  entry.started = now;
+  if (entry.async) {
+    co::spawn(_update_async(entry));
+    return;
+  }
+
+  entry.work.data = &entry;
+  uv_queue_work(uv_default_loop(), &entry.work, &_work, &_after_work);
+}
+
+// Runs on a thread pool thread.
+void update_scheduler::_work(uv_work_t *work) {
+  auto &entry = *(update_scheduler::entry *)work->data;
+  try {
+    perf::timing::scope measure(entry.block->perf_stats().update);
+    entry.block->update();
+  } catch (...) {
+    entry.exception = std::current_exception();
+  }
+}
+
+void update_scheduler::_after_work(uv_work_t *work, int) {
+  auto &entry = *(update_scheduler::entry *)work->data;
+  entry.owner->_completed(entry);
+}
+
+co::task<> update_scheduler::_update_async(entry &entry) {
+  try {
+    co_await entry.async->update_async();
+  } catch (...) {
+    entry.exception = std::current_exception();
+  }
+  entry.owner->_completed(entry);
+}
+
+void update_scheduler::_completed(entry &entry) {
+  auto now = uv_now(uv_default_loop());
+
+  entry.in_flight = false;
+  // Errors are handled the same way as those of updates that run on the loop thread.
+  if (auto exception = std::exchange(entry.exception, nullptr))
+    std::rethrow_exception(exception);
+
+  bool was_stale = entry.block->_stale.exchange(false, std::memory_order_relaxed);
+  bool redraw = _finished(entry, now) || was_stale;
+  if (std::exchange(entry.triggered, false))
+    entry.next = now;
+  if (redraw && !hidden())
+    bar::instance().schedule_redraw();
+  _arm(now);
+}
+
+void update_scheduler::_arm(std::uint64_t now) {
+  auto next = std::numeric_limits<std::uint64_t>::max();
+  for (auto const &entry : _entries) {
+    next = std::min(next, entry.next);
+    // Wake up to mark a block stale when its update misses the deadline.
+    if (entry.in_flight && !entry.block->stale())
+      next = std::min(next, entry.started + blocking_update_deadline);
+  }
+
+  if (next == std::numeric_limits<std::uint64_t>::max())
+    return;
+  uv_timer_start(&_timer, &_on_timer, next > now ? next - now : 0, 0);
+}
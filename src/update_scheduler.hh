@@ -0,0 +1,131 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <list>
+
+#include <uv.h>
+
+#include "co.hh"
+#include "util.hh"
+
+class SimpleBlock;
+class AsyncBlock;
+
+// Runs the periodic updates of all SimpleBlocks from a single libuv timer.
+//
+// Update intervals are rounded to a multiple of the tick and every block is
+// updated when the loop time crosses a multiple of its interval. Blocks whose
+// intervals share a multiple (500ms and 1s, 1s and 3s...) are therefore
+// updated in the same wakeup, and all updates done in one wakeup result in at
+// most one redraw.
+//
+// The first update of every block is done by the scheduler too, right away on
+// the thread pool if the block's updates may run there, otherwise as soon as
+// the loop runs, see SimpleBlock::ready().
+//
+// Blocks whose max_update_interval() is longer than their update_interval()
+// back off while their output is stable: every update that doesn't need a
+// redraw doubles the interval up to the maximum, one that does (or a call to
+// reset()) goes back to the base interval.
+//
+// Updates of blocks that say they may block are run on the libuv thread pool
+// instead, at most one at a time per block. If one doesn't finish within
+// config::blocking_update_deadline the block is marked stale until it does,
+// the loop thread never waits for it. The same goes for the coroutines of
+// AsyncBlocks, which run on the loop thread but may take a while to finish.
+class update_scheduler {
+  struct entry {
+    update_scheduler *owner;
+    SimpleBlock *block;
+    // Set if the block is an AsyncBlock.
+    AsyncBlock *async = nullptr;
+    // Whether update() runs on the thread pool, see SimpleBlock::update_may_block
+    // and offload().
+    bool on_worker = false;
+    // Applied on top of the scale by widen().
+    double widening = 1;
+    // The intervals the block asked for, before scaling and rounding.
+    std::chrono::milliseconds nominal_base, nominal_max;
+    // All in milliseconds of loop time and multiples of the tick.
+    std::uint64_t base_interval = 0;
+    std::uint64_t max_interval = 0;
+    std::uint64_t interval = 0;
+    std::uint64_t next = 0;
+
+    // For updates running on the thread pool or as a coroutine.
+    uv_work_t work{};
+    bool in_flight = false;
+    // trigger() was called while in flight.
+    bool triggered = false;
+    std::uint64_t started = 0;
+    std::exception_ptr exception{};
+  };
+
+  uv_timer_t _timer;
+  bool _timer_initialized = false;
+  std::uint64_t _tick = 100;
+  double _scale = 1;
+  // Lower bound for all intervals while the bar is hidden, zero while it isn't.
+  std::uint64_t _hidden_interval = 0;
+  // A list because in flight work requests point into it.
+  std::list<entry> _entries;
+  // Blocks that haven't finished their first update yet.
+  std::size_t _first_updates_pending = 0;
+
+  std::uint64_t _round(std::chrono::milliseconds) const;
+  void _apply_scale(entry &, std::uint64_t now);
+  static void _on_timer(uv_timer_t *);
+  void _run(std::uint64_t now, bool all = false);
+  // Adjusts the interval after an update finished, returns whether a redraw is needed.
+  bool _finished(entry &, std::uint64_t now);
+  void _dispatch(entry &, std::uint64_t now);
+  static void _work(uv_work_t *);
+  static void _after_work(uv_work_t *, int status);
+  static co::task<> _update_async(entry &);
+  void _completed(entry &);
+  void _arm(std::uint64_t now);
+
+public:
+  update_scheduler() = default;
+
+  BAR_NON_COPYABLE(update_scheduler);
+  BAR_NON_MOVEABLE(update_scheduler);
+
+  // Must be called before any block is added.
+  void configure(std::chrono::milliseconds tick);
+
+  // Starts updating the block periodically according to its update_interval(),
+  // blocks with an infinite interval are ignored.
+  void add(SimpleBlock &);
+  // Drops the block back to its base interval, for when something outside of
+  // the block's update() (a signal, ...) says that its output is about to change.
+  // Must be called from the loop thread.
+  void reset(SimpleBlock &);
+  // Like reset() but also updates the block as soon as possible, that is right
+  // after the update that is still running if there is one. Must be called from
+  // the loop thread.
+  void trigger(SimpleBlock &);
+  // For the watchdog, both return false if there was nothing left to do. Must be
+  // called from the loop thread.
+  //
+  // Runs the block's updates on the thread pool from now on, the block must
+  // support that (see SimpleBlock::update_may_move).
+  bool offload(SimpleBlock &);
+  // Doubles the block's intervals, up to max_factor times what it asked for.
+  bool widen(SimpleBlock &, double max_factor);
+
+  // Multiplies every block's intervals by the given factor (see power::profile),
+  // blocks go back to their base interval. Must be called from the loop thread.
+  void scale(double);
+
+  // While the bar is hidden every block is updated at most once per the given
+  // interval. Must be called from the loop thread.
+  void hide(std::chrono::milliseconds interval);
+  // Undoes hide(), every block is updated right away and a single redraw is
+  // requested for all of them.
+  void show();
+  bool hidden() const { return _hidden_interval != 0; }
+};
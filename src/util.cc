@@ -1,5 +1,9 @@
+#include <cstdlib>
+#include <cxxabi.h>
+#include <memory>
 #include <regex>
 #include <string>
+#include <typeinfo>
 
 #include <fmt/core.h>
 
@@ -54,3 +58,10 @@ std::string quote(std::string_view str, char quote, char escape) {
   s.push_back(quote);
   return s;
 }
+
+std::string demangled_name(std::type_info const &type) {
+  int status;
+  std::unique_ptr<char, decltype(&std::free)> name(abi::__cxa_demangle(type.name(), nullptr, nullptr, &status),
+                                                   &std::free);
+  return status == 0 ? name.get() : type.name();
+}
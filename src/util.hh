@@ -15,6 +15,7 @@
 #include <string_view>
 #include <tuple>
 #include <type_traits>
+#include <typeinfo>
 
 #include "ui/gl.hh"
 
@@ -71,6 +72,9 @@ std::string_view trim(std::string_view str, std::string_view ws = "\t\n\r ");
 
 std::string quote(std::string_view, char quote = '"', char escape = '\\');
 
+// Human readable name of a type, for logging.
+std::string demangled_name(std::type_info const &);
+
 namespace _private {
 template <typename T> struct concatenate_sizer {
   std::size_t operator()(T const &value) {
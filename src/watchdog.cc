@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <chrono>
+#include <typeinfo>
+
+#include "bar.hh"
+#include "config.hh"
+#include "watchdog.hh"
+
+static std::uint64_t ns(auto duration) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+
+void watchdog::complaint::add(std::uint64_t n, std::uint64_t worst) {
+  count += n;
+  worst_ns = std::max(worst_ns, worst);
+}
+
+bool watchdog::complaint::due(perf::clock::time_point now) {
+  if (count == 0 || now - last_logged < config::watchdog::log_interval)
+    return false;
+  last_logged = now;
+  return true;
+}
+
+void watchdog::start() {
+  if (config::watchdog::interval == config::watchdog::interval.zero())
+    return;
+
+  auto *loop = uv_default_loop();
+  uv_timer_init(loop, &_timer);
+  _timer.data = this;
+  // Nothing to watch once everything else is done.
+  uv_unref((uv_handle_t *)&_timer);
+
+  auto interval = std::chrono::duration_cast<std::chrono::milliseconds>(config::watchdog::interval).count();
+  uv_update_time(loop);
+  _expected = uv_hrtime() + ns(config::watchdog::interval);
+  uv_timer_start(
+      &_timer, [](uv_timer_t *timer) { ((watchdog *)timer->data)->_check(); }, interval, interval);
+}
+
+void watchdog::_check() {
+  auto now = perf::clock::now();
+
+  // Anything beyond when the timer was due is time the loop thread spent on
+  // something else. libuv schedules the next run relative to now.
+  auto hrnow = uv_hrtime();
+  auto lag = hrnow > _expected ? hrnow - _expected : 0;
+  _expected = hrnow + ns(config::watchdog::interval);
+  perf::global().loop_lag.record(std::chrono::nanoseconds(lag));
+
+  if (lag > ns(config::watchdog::loop_lag_budget))
+    _lag.add(1, lag);
+  if (_lag.due(now)) {
+    fmt::print(warn, "Loop thread lagged behind by more than {}ms {} times, by up to {:.1f}ms\n",
+               ns(config::watchdog::loop_lag_budget) / 1'000'000, std::exchange(_lag.count, 0),
+               std::exchange(_lag.worst_ns, 0) / 1e6);
+  }
+
+  bar::instance().for_each_block([&](Block &block) { _check_block(block, now); });
+}
+
+void watchdog::_check_block(Block &block, perf::clock::time_point now) {
+  auto &stats = block.perf_stats();
+  auto &state = _blocks[&block];
+
+  auto slow_updates = stats.update.over_budget.exchange(0, std::memory_order_relaxed);
+  auto slow_draws = stats.draw.over_budget.exchange(0, std::memory_order_relaxed);
+  // Only the duration of the last run is kept around, which is at least close
+  // to the worst one for blocks that are slow all the time.
+  if (slow_updates)
+    state.slow_updates.add(slow_updates, stats.update.last_ns.load(std::memory_order_relaxed));
+  if (slow_draws)
+    state.slow_draws.add(slow_draws, stats.draw.last_ns.load(std::memory_order_relaxed));
+
+  if (state.slow_updates.due(now))
+    fmt::print(warn, "{}: {} updates took longer than {}ms, up to {:.1f}ms\n", demangled_name(typeid(block)),
+               std::exchange(state.slow_updates.count, 0), ns(config::watchdog::update_budget) / 1'000'000,
+               std::exchange(state.slow_updates.worst_ns, 0) / 1e6);
+  if (state.slow_draws.due(now))
+    fmt::print(warn, "{}: {} draws took longer than {}ms, up to {:.1f}ms\n", demangled_name(typeid(block)),
+               std::exchange(state.slow_draws.count, 0), ns(config::watchdog::draw_budget) / 1'000'000,
+               std::exchange(state.slow_draws.worst_ns, 0) / 1e6);
+
+  // Blocks with long intervals aren't updated between every two checks, only an
+  // update that stayed within its budget takes the strikes away.
+  auto updates = stats.update.count.load(std::memory_order_relaxed);
+  if (slow_updates)
+    state.strikes += 1;
+  else if (updates != state.updates_seen)
+    state.strikes = 0;
+  state.updates_seen = updates;
+
+  if (state.strikes >= config::watchdog::strikes) {
+    state.strikes = 0;
+    _punish(block);
+  }
+}
+
+// Only updates on the loop thread are checked against the budget, so the block
+// is a SimpleBlock that isn't running on the thread pool yet.
+void watchdog::_punish(Block &block) {
+  auto *simple = dynamic_cast<SimpleBlock *>(&block);
+  if (!simple)
+    return;
+
+  auto &updates = bar::instance().updates();
+  auto name = demangled_name(typeid(block));
+  if (config::watchdog::offload && simple->update_may_move() && updates.offload(*simple))
+    fmt::print(warn, "{} keeps going over its update budget, moving its updates to a worker thread\n", name);
+  else if (updates.widen(*simple, config::watchdog::max_widening))
+    fmt::print(warn, "{} keeps going over its update budget, updating it less often\n", name);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+#include <uv.h>
+
+#include "block.hh"
+#include "perf.hh"
+#include "util.hh"
+
+// Notices when the loop thread is kept busy for too long and by whom.
+//
+// A timer measures how late the loop thread gets around to it (the loop lag),
+// and on the same timer every block's updates and draws are checked against
+// the budgets in config::watchdog. Offenders are logged with rate limiting,
+// blocks whose loop thread updates keep going over budget are moved to a
+// worker thread or updated less often, see update_scheduler::offload and
+// update_scheduler::widen.
+class watchdog {
+  // One kind of complaint about one thing, logged at most once per
+  // config::watchdog::log_interval with how often it happened in between.
+  struct complaint {
+    perf::clock::time_point last_logged{};
+    std::uint64_t count = 0;
+    std::uint64_t worst_ns = 0;
+
+    void add(std::uint64_t count, std::uint64_t ns);
+    // Returns true and starts counting anew if it is time to log.
+    bool due(perf::clock::time_point now);
+  };
+
+  struct block_state {
+    complaint slow_updates;
+    complaint slow_draws;
+    // Checks in which the block went over its update budget since it last stayed within it.
+    unsigned strikes = 0;
+    std::uint64_t updates_seen = 0;
+  };
+
+  uv_timer_t _timer;
+  // uv_hrtime() at which the timer should fire next.
+  std::uint64_t _expected = 0;
+  complaint _lag;
+  std::unordered_map<Block const *, block_state> _blocks;
+
+  void _check();
+  void _check_block(Block &, perf::clock::time_point now);
+  void _punish(Block &);
+
+public:
+  watchdog() = default;
+
+  BAR_NON_COPYABLE(watchdog);
+  BAR_NON_MOVEABLE(watchdog);
+
+  // Must be called from the loop thread after all blocks were added.
+  void start();
+};
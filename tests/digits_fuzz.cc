@@ -0,0 +1,87 @@
+// Feeds the digits kernels random lines and checks that every one the CPU
+// supports parses them exactly like the scalar one: the same numbers, the same
+// count and the same end position.
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "digits.hh"
+
+namespace {
+
+constexpr int iterations = 300000;
+
+// Mostly /proc-like text, sometimes long digit runs (which wrap around) or
+// arbitrary bytes.
+std::string random_line(std::mt19937_64 &rng) {
+  constexpr std::string_view procfs = "0123456789 \n\tcpu-x";
+
+  std::string line;
+  size_t length = rng() % 200;
+  switch (rng() % 3) {
+  case 0:
+    for (size_t i = 0; i < length; ++i)
+      line += procfs[rng() % procfs.size()];
+    break;
+  case 1:
+    for (size_t i = 0; i < length; ++i)
+      line += rng() % 8 ? char('0' + rng() % 10) : ' ';
+    break;
+  default:
+    for (size_t i = 0; i < length; ++i)
+      line += char(rng() % 256);
+    break;
+  }
+  return line;
+}
+
+struct result {
+  std::size_t count;
+  char const *end;
+  std::vector<std::uint64_t> numbers;
+
+  bool operator==(result const &) const = default;
+};
+
+result run(digits::kernel k, std::string const &line, size_t start, size_t max_numbers) {
+  result r{0, nullptr, std::vector<std::uint64_t>(max_numbers)};
+  char const *it = line.data() + start;
+  r.count = digits::parse(k, it, line.data() + line.size(), r.numbers);
+  r.end = it;
+  return r;
+}
+
+} // namespace
+
+int main() {
+  std::vector<digits::kernel> kernels;
+  for (auto k : {digits::kernel::sse2, digits::kernel::avx2})
+    if (digits::supported(k))
+      kernels.push_back(k);
+  if (kernels.empty()) {
+    std::printf("only the scalar kernel is supported, nothing to compare\n");
+    return 0;
+  }
+
+  std::mt19937_64 rng(1);
+  for (int i = 0; i < iterations; ++i) {
+    auto line = random_line(rng);
+    size_t start = line.empty() ? 0 : rng() % line.size();
+    size_t max_numbers = rng() % 25;
+
+    auto expected = run(digits::kernel::scalar, line, start, max_numbers);
+    for (auto k : kernels) {
+      if (run(k, line, start, max_numbers) != expected) {
+        std::printf("%s differs from scalar in iteration %d\n", digits::name(k).data(), i);
+        return 1;
+      }
+    }
+  }
+
+  for (auto k : kernels)
+    std::printf("%s matches scalar in %d cases\n", digits::name(k).data(), iterations);
+  return 0;
+}